@@ -12,7 +12,9 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <algorithm>
 #include <limits>
+#include <memory>
 #include <vector>
 
 #include <Error.hpp>
@@ -22,6 +24,7 @@ namespace vflib
 
 	typedef uint32_t nodeID_t; /**<Type for the id of the nodes in the graph */
 	const nodeID_t NULL_NODE = (std::numeric_limits<uint32_t>::max)();	/**<Null node value */
+	const uint32_t ADJ_BITMAP_MIN_DEGREE = 16;	/**<Min out degree of a node to get a bitmap row when the budget is short */
 
 	/**
 	 * @class Empty
@@ -46,6 +49,40 @@ namespace vflib
 
 	};
 
+	/**
+	 * @struct EdgeAttrTraits
+	 * @brief Tells whether the edge attributes of a given type are stored.
+	 * @details Empty attributes carry no information: the graphs don't
+	 * allocate them and the matching states don't compare them.
+	 */
+	template <typename Edge>
+	struct EdgeAttrTraits
+	{
+		static const bool stored = true;
+	};
+
+	template <>
+	struct EdgeAttrTraits<Empty>
+	{
+		static const bool stored = false;
+	};
+
+	/**
+	 * @brief Checks the compatibility of two edge attributes.
+	 * @note The check compiles out when neither type is stored.
+	 * @param [in] ef Edge comparison functor.
+	 * @param [in] attr1 Attribute of the first edge.
+	 * @param [in] attr2 Attribute of the second edge.
+	 * @returns TRUE if the attributes are compatible.
+	 */
+	template <typename Edge1, typename Edge2, typename EdgeComparisonFunctor>
+	inline bool CompatibleEdges(EdgeComparisonFunctor &ef, Edge1 &attr1, Edge2 &attr2)
+	{
+		if (!EdgeAttrTraits<Edge1>::stored && !EdgeAttrTraits<Edge2>::stored)
+			return true;
+		return ef(attr1, attr2);
+	}
+
 	/**
 	 * @class EqualityComparator
 	 * @brief Default Functors for Node/Edge Attributes Equality Test.
@@ -60,6 +97,23 @@ namespace vflib
 		}
 	};
 
+	/**
+	* @struct ARGraphData
+	* @brief Flat arrays holding the nodes and the edges of an ARGraph.
+	* @see ARGraph
+	*/
+	template <typename Node, typename Edge>
+	struct ARGraphData
+	{
+		std::vector<Node> attr;                   /**<node attributes */
+		std::vector<uint32_t> in_offset;          /**<start of the 'in' edges of each node in in_nodes (n+1 entries) */
+		std::vector<uint32_t> out_offset;         /**<start of the 'out' edges of each node in out_nodes (n+1 entries) */
+		std::vector<nodeID_t> in_nodes;           /**<nodes connected by 'in' edges, grouped by node */
+		std::vector<nodeID_t> out_nodes;          /**<nodes connected by 'out' edges, grouped by node */
+		std::vector<Edge> in_attr;                /**<edge attributes for 'in' edges, parallel to in_nodes */
+		std::vector<Edge> out_attr;               /**<edge attributes for 'out' edges, parallel to out_nodes */
+	};
+
 	/**
 	* @class ARGLoader
 	* @brief Abstract class ARGLoader. Allows to construct an ARGraph.
@@ -101,6 +155,48 @@ namespace vflib
 		* @returns End node id.
 		*/
 		virtual nodeID_t GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr) = 0;
+		/**
+		* @brief Hands the whole graph over at once.
+		* @details Loaders already keeping the graph in flat arrays can
+		* override this method to move them into the ARGraph, sparing a
+		* virtual call per edge. Only attr, out_offset, out_nodes and
+		* out_attr must be filled; the in edges are derived by the graph.
+		* out_attr can be left empty if EdgeAttrTraits<Edge>::stored is false.
+		* After a successful call the loader is left empty.
+		* @param [out] data Arrays of the graph.
+		* @returns FALSE if the graph must be read edge by edge.
+		*/
+		virtual bool ReleaseGraphData(ARGraphData<Node, Edge> &/*data*/) { return false; }
+	};
+
+	/**
+	* @struct ARGraphView
+	* @brief Flat arrays of an ARGraph living in memory not owned by the graph.
+	* @details The layout of the arrays is the one of ARGraphData. Together with
+	* the precomputed statistics it allows to build a graph without parsing
+	* or copying anything, e.g. on top of a memory mapped snapshot.
+	* The owner, if set, is kept alive as long as the graph.
+	*/
+	template <typename Node, typename Edge>
+	struct ARGraphView
+	{
+		uint32_t n;                               /**<number of nodes */
+		uint32_t e_count;                         /**<sum of the degrees of the nodes */
+		uint32_t e_in_count;                      /**<number of 'in' edges */
+		uint32_t e_out_count;                     /**<number of 'out' edges */
+		uint32_t max_deg_in;                      /**<max in degree */
+		uint32_t max_deg_out;                     /**<max out degree */
+		uint32_t max_degree;                      /**<max degree */
+		uint32_t n_attr_count;                    /**<number of different node attributes */
+		uint32_t e_attr_count;                    /**<number of different edge attributes */
+		Node *attr;
+		uint32_t *in_offset;
+		uint32_t *out_offset;
+		nodeID_t *in_nodes;
+		nodeID_t *out_nodes;
+		Edge *in_attr;
+		Edge *out_attr;
+		std::shared_ptr<void> owner;              /**<keeps the memory of the arrays alive */
 	};
 
 	/**
@@ -112,9 +208,18 @@ namespace vflib
 	* suited for efficient graph matching, which is the primary target
 	* of this program.
 	*
-	* Edges and edge attributes (pointers) are stored into sorted
-	* vectors associated to each node, and are looked for
-	* using binary search.
+	* Edges and edge attributes are stored in compressed sparse row
+	* (CSR) form: for each direction a single offsets array indexes
+	* one contiguous array of neighbors, sorted by node id inside the
+	* range of each node, and a parallel array of edge attributes.
+	* Edges are looked for using binary search.
+	* When EdgeAttrTraits<Edge>::stored is false (e.g. Empty edges) the
+	* edge attribute arrays are not allocated at all, and every edge
+	* shares a single attribute.
+	* The arrays are either owned by the graph (ARGraphData), possibly
+	* moved in from a loader or an application without any copy, or
+	* borrowed from an external memory area (ARGraphView), such as a
+	* mapped binary snapshot.
 	*
 	* Nodes are identified using the type node_id, which is currently
 	* unsigned short; the special value NULL_NODE is used as null
@@ -126,7 +231,9 @@ namespace vflib
 	*
 	* Differently from the previous versions  of this library
 	* (before version 2.0), there is no more an adjacency matrix to
-	* check for the existence of a node.
+	* check for the existence of a node by default. An adjacency
+	* bitmap can be built on demand with BuildAdjacencyBitmap, within
+	* a memory budget, to make HasEdge constant time on dense graphs.
 	* @see argloader.hpp
 	* @see argedit.hpp
 	*/
@@ -141,7 +248,7 @@ namespace vflib
 			param_type param);					/**<Type for the visitor of edges in the graph */
 
 	private:
-		typedef std::vector<nodeID_t> NodeVec;
+		typedef std::vector<uint32_t> OffsetVec;
 		typedef std::vector<Edge> EdgeAttrVector;
 		typedef std::vector<Node> NodeAttrVector;
 
@@ -155,16 +262,67 @@ namespace vflib
 		uint32_t max_deg_in;                      /**<max in degree over all the nodes*/
 		uint32_t max_deg_out;                     /**<max out degree over all the nodes */
 		uint32_t max_degree;                      /**<max degree over all the nodes */
-		NodeAttrVector attr;                 /**<node attributes  */
-		std::vector<EdgeAttrVector> in_attr;      /**<Edge attributes for 'in' edges */
-		std::vector<EdgeAttrVector> out_attr;     /**<Edge attributes for 'out' edges */
-		std::vector<NodeVec> in;                  /**<nodes connected by 'in' edges to each n*/
-		std::vector<NodeVec> out;                 /**<nodes connected by 'out' edges to each node */
+		Node *attr;                               /**<node attributes  */
+		uint32_t *in_offset;                      /**<start of the 'in' edges of each node in in_nodes (n+1 entries) */
+		uint32_t *out_offset;                     /**<start of the 'out' edges of each node in out_nodes (n+1 entries) */
+		nodeID_t *in_nodes;                       /**<nodes connected by 'in' edges, grouped by node */
+		nodeID_t *out_nodes;                      /**<nodes connected by 'out' edges, grouped by node */
+		Edge *in_attr;                            /**<Edge attributes for 'in' edges, parallel to in_nodes */
+		Edge *out_attr;                           /**<Edge attributes for 'out' edges, parallel to out_nodes */
+		ARGraphData<Node, Edge> data;             /**<arrays owned by the graph, empty for a view */
+		std::shared_ptr<void> owner;              /**<keeps alive the arrays of a view */
+		std::vector<uint64_t> adj_bits;           /**<optional adjacency bitmap, one row of adj_words words per selected node */
+		std::vector<uint32_t> adj_row;            /**<row of each node in adj_bits, NULL_NODE if the node has no row; empty for a full matrix */
+		uint32_t adj_words;                       /**<number of 64 bit words of a bitmap row */
+		Edge no_attr;                             /**<attribute of all the edges when the attributes are not stored */
+
+		/**
+		* @brief Neighbors of each node grouped by class, see BuildClassIndex.
+		* @details The runs of node i are first_run[i] .. first_run[i+1]-1;
+		* run k holds the neighbors of class run_class[k], from nodes[run_start[k]]
+		* to the start of the next run of the node, or to the end of its edges.
+		*/
+		struct ClassIndex
+		{
+			std::vector<nodeID_t> nodes;          /**<neighbors, grouped by node, then by class, then by id */
+			std::vector<uint32_t> first_run;      /**<first run of each node (n+1 entries), empty if not built */
+			std::vector<uint32_t> run_class;      /**<class of each run, increasing inside a node */
+			std::vector<uint32_t> run_start;      /**<first neighbor of each run in nodes */
+		};
+		ClassIndex class_out;                     /**<class index of the 'out' edges */
+		ClassIndex class_in;                      /**<class index of the 'in' edges */
+		const uint32_t* index_classes;            /**<classes the class index was built from, NULL if not built */
+
+		/**
+		* @brief Index of the attribute of an edge in in_attr or out_attr.
+		* @details If the edge attributes are not stored both the arrays
+		* point to no_attr, and every edge maps to it.
+		*/
+		static uint32_t AttrIndex(uint32_t e) { return EdgeAttrTraits<Edge>::stored ? e : 0; }
 
 		bool GetNodeIndex(nodeID_t n1, nodeID_t n2, nodeID_t &index) const;
+		bool GetInNodeIndex(nodeID_t n1, nodeID_t n2, nodeID_t &index) const;
+		int TestAdjacencyBit(nodeID_t n1, nodeID_t n2) const;
+		void FillAdjacencyRow(nodeID_t node, uint64_t *row) const;
+		static uint32_t CompactRow(nodeID_t *nodes, Edge *attrs, uint32_t begin, uint32_t end, uint32_t dest);
+		static void CompactEdges(uint32_t n, std::vector<uint32_t> &offset, std::vector<nodeID_t> &nodes,
+			std::vector<Edge> &attrs, const char *direction);
+		template <typename T>
+		static uint32_t CountDistinct(std::vector<T> &values);
+		static bool FindNode(const nodeID_t* set, uint32_t count, nodeID_t node, nodeID_t &index);
+		static void BuildClassRuns(uint32_t n, const uint32_t* offset, const nodeID_t* set,
+			const uint32_t* classes, ClassIndex &index);
+		static const nodeID_t* FindClassRun(const ClassIndex &index, const uint32_t* offset,
+			nodeID_t node, uint32_t c, uint32_t &count);
+		void BindData();
+		void AdoptData();
 
 	public:
 		ARGraph(ARGLoader<Node, Edge> *loader);
+		ARGraph(ARGraphData<Node, Edge> &&graph_data);
+		ARGraph(const ARGraphView<Node, Edge> &view);
+		ARGraph(const ARGraph &g);
+		ARGraph& operator=(const ARGraph &g);
 
 		uint32_t NodeCount() const;
 		uint32_t EdgeCount() const;
@@ -189,6 +347,23 @@ namespace vflib
 		nodeID_t* GetOutEdgeSet(nodeID_t node);
 		nodeID_t* GetInEdgeSet(nodeID_t node);
 
+		size_t BuildAdjacencyBitmap(size_t max_bytes);
+		/**
+		* @brief Checks if an adjacency bitmap has been built
+		* @returns TRUE if at least one node has a bitmap row
+		*/
+		bool HasAdjacencyBitmap() const { return !adj_bits.empty(); }
+
+		void BuildClassIndex(const uint32_t* classes);
+		/**
+		* @brief Checks if the class index has been built from the given classes
+		* @param [in] classes Class of each node, as passed to BuildClassIndex.
+		* @returns TRUE if the neighbors of these classes can be listed by class
+		*/
+		bool HasClassIndex(const uint32_t* classes) const { return index_classes && index_classes == classes; }
+		const nodeID_t* GetOutEdgesOfClass(nodeID_t node, uint32_t c, uint32_t &count) const;
+		const nodeID_t* GetInEdgesOfClass(nodeID_t node, uint32_t c, uint32_t &count) const;
+
 		/**
 		* @brief Maximum incoming degree in the graph
 		* @returns Maximum in degree
@@ -284,35 +459,255 @@ namespace vflib
 	template <typename Node, typename Edge>
 	inline bool ARGraph<Node, Edge>::HasEdge(nodeID_t n1, nodeID_t n2) const
 	{
+		int bit = TestAdjacencyBit(n1, n2);
+		if (bit >= 0)
+			return bit != 0;
+
 		nodeID_t index;
 		return GetNodeIndex(n1, n2, index);
 	}
 
 	/**
-	* @brief Gets the index of node n2 in the neighboors set of n1.
-	* @param [in] n1 First node id.
-	* @param [in] n2 Second node id.
-	* @param [out] index Index of the node n2 in the neighboors set of n1.
-	* @retval TRUE If the the nodes n2 is a neighboor of n1.
-	* @retval FALSE If the the nodes n2 isn't a neighboor of n1.
+	* @brief Looks for an edge in the adjacency bitmap.
+	* @param [in] n1 Start node id.
+	* @param [in] n2 End node id.
+	* @returns 1 if the edge exists, 0 if it doesn't exist,
+	* -1 if the node n1 has no bitmap row.
 	*/
 	template <typename Node, typename Edge>
-	inline bool ARGraph<Node, Edge>::GetNodeIndex(nodeID_t n1, nodeID_t n2, nodeID_t &index) const
+	inline int ARGraph<Node, Edge>::TestAdjacencyBit(nodeID_t n1, nodeID_t n2) const
 	{
-		unsigned long a, b, c;
-		//NodeVec id = out[n1];
-
 		assert(n1 < n);
 		assert(n2 < n);
 
+		if (adj_bits.empty())
+			return -1;
+		size_t row = n1;
+		if (!adj_row.empty())
+		{
+			if (adj_row[n1] == NULL_NODE)
+				return -1;
+			row = adj_row[n1];
+		}
+		return (int)((adj_bits[row * adj_words + (n2 >> 6)] >> (n2 & 63)) & 1);
+	}
+
+	/**
+	* @brief Sets in a bitmap row the out neighbors of a node.
+	*/
+	template <typename Node, typename Edge>
+	void ARGraph<Node, Edge>::FillAdjacencyRow(nodeID_t node, uint64_t *row) const
+	{
+		for (uint32_t i = out_offset[node]; i < out_offset[node + 1]; i++)
+			row[out_nodes[i] >> 6] |= (uint64_t)1 << (out_nodes[i] & 63);
+	}
+
+	/**
+	* @brief Builds the adjacency bitmap of the out edges.
+	* @details If the whole n x n matrix fits in the budget every node gets
+	* a row. Otherwise rows are given only to the nodes with the highest out
+	* degree (at least ADJ_BITMAP_MIN_DEGREE), as many as the budget allows
+	* after the table mapping each node to its row;
+	* the other nodes keep using binary search.
+	* Any previously built bitmap is released.
+	* @param [in] max_bytes Memory budget for the bitmap, in bytes.
+	* @returns Number of bytes used by the bitmap and its row table.
+	*/
+	template <typename Node, typename Edge>
+	size_t ARGraph<Node, Edge>::BuildAdjacencyBitmap(size_t max_bytes)
+	{
+		uint32_t i;
+		size_t r, rows, row_bytes, table_bytes;
+		std::vector<nodeID_t> selected;
+
+		std::vector<uint64_t>().swap(adj_bits);
+		std::vector<uint32_t>().swap(adj_row);
+		adj_words = (n + 63) >> 6;
+		if (!adj_words)
+			return 0;
+
+		row_bytes = adj_words * sizeof(uint64_t);
+		table_bytes = (size_t)n * sizeof(uint32_t);
+		if (max_bytes / row_bytes >= n)
+		{
+			//Every node has its own row, no row table needed
+			adj_bits.assign((size_t)n * adj_words, 0);
+			for (i = 0; i < n; i++)
+				FillAdjacencyRow(i, &adj_bits[(size_t)i * adj_words]);
+			return adj_bits.size() * sizeof(uint64_t);
+		}
+
+		if (max_bytes <= table_bytes)
+			return 0;
+		rows = (max_bytes - table_bytes) / row_bytes;
+
+		for (i = 0; i < n; i++)
+			if (OutEdgeCount(i) >= ADJ_BITMAP_MIN_DEGREE)
+				selected.push_back(i);
+
+		if (selected.size() > rows)
+		{
+			struct DegreeGreater
+			{
+				const ARGraph *g;
+				bool operator()(nodeID_t a, nodeID_t b) const
+				{
+					return g->OutEdgeCount(a) > g->OutEdgeCount(b);
+				}
+			} greater = { this };
+			std::nth_element(selected.begin(), selected.begin() + rows, selected.end(), greater);
+			selected.resize(rows);
+		}
+
+		if (selected.empty())
+			return 0;
+
+		adj_row.assign(n, NULL_NODE);
+		adj_bits.assign(selected.size() * adj_words, 0);
+		for (r = 0; r < selected.size(); r++)
+		{
+			adj_row[selected[r]] = (uint32_t)r;
+			FillAdjacencyRow(selected[r], &adj_bits[r * adj_words]);
+		}
+
+		return adj_bits.size() * sizeof(uint64_t) + table_bytes;
+	}
+
+	/**
+	* @brief Groups by class the neighbors of each node for one direction.
+	* @details Each node keeps its range in offset; inside it the neighbors
+	* are reordered by class, keeping the order of the ids for each class.
+	*/
+	template <typename Node, typename Edge>
+	void ARGraph<Node, Edge>::BuildClassRuns(uint32_t n, const uint32_t* offset,
+		const nodeID_t* set, const uint32_t* classes, ClassIndex &index)
+	{
+		uint32_t i, j;
+
+		index.nodes.assign(set, set + offset[n]);
+		index.first_run.resize(n + 1);
+		index.run_class.clear();
+		index.run_start.clear();
+		for (i = 0; i < n; i++)
+		{
+			nodeID_t *first = index.nodes.data() + offset[i];
+			nodeID_t *last = index.nodes.data() + offset[i + 1];
+			std::stable_sort(first, last, [classes](nodeID_t a, nodeID_t b) {
+				return classes[a] < classes[b];
+			});
+
+			index.first_run[i] = (uint32_t)index.run_class.size();
+			for (j = offset[i]; j < offset[i + 1]; j++)
+			{
+				uint32_t c = classes[index.nodes[j]];
+				if (j == offset[i] || c != index.run_class.back())
+				{
+					index.run_class.push_back(c);
+					index.run_start.push_back(j);
+				}
+			}
+		}
+		index.first_run[n] = (uint32_t)index.run_class.size();
+	}
+
+	/**
+	* @brief Looks for the neighbors of a class of a node.
+	* @param [out] count Number of neighbors of the class.
+	* @returns First neighbor of the class.
+	*/
+	template <typename Node, typename Edge>
+	inline const nodeID_t* ARGraph<Node, Edge>::FindClassRun(const ClassIndex &index,
+		const uint32_t* offset, nodeID_t node, uint32_t c, uint32_t &count)
+	{
+		const uint32_t *first = index.run_class.data() + index.first_run[node];
+		const uint32_t *last = index.run_class.data() + index.first_run[node + 1];
+		const uint32_t *run = std::lower_bound(first, last, c);
+		if (run == last || *run != c)
+		{
+			count = 0;
+			return index.nodes.data();
+		}
+
+		uint32_t k = (uint32_t)(run - index.run_class.data());
+		uint32_t end = run + 1 < last ? index.run_start[k + 1] : offset[node + 1];
+		count = end - index.run_start[k];
+		return index.nodes.data() + index.run_start[k];
+	}
+
+	/**
+	* @brief Builds the index of the neighbors of each node by class.
+	* @details Lets the matching states look only at the neighbors of the
+	* class they need, which matters for nodes with many neighbors and many
+	* classes. It takes another copy of the edges; any previous index is
+	* replaced. The index is used only by the states given the same classes
+	* array, that must not change while the index is in use.
+	* @param [in] classes Class of each node.
+	*/
+	template <typename Node, typename Edge>
+	void ARGraph<Node, Edge>::BuildClassIndex(const uint32_t* classes)
+	{
+		BuildClassRuns(n, out_offset, out_nodes, classes, class_out);
+		BuildClassRuns(n, in_offset, in_nodes, classes, class_in);
+		index_classes = classes;
+	}
+
+	/**
+	* @brief Gets the out neighbors of a node with a given class.
+	* @note The class index must have been built.
+	* @param [in] node Node id.
+	* @param [in] c Class.
+	* @param [out] count Number of neighbors of the class.
+	* @returns The neighbors of the class, by increasing id.
+	*/
+	template <typename Node, typename Edge>
+	inline const nodeID_t* ARGraph<Node, Edge>::GetOutEdgesOfClass(nodeID_t node,
+		uint32_t c, uint32_t &count) const
+	{
+		assert(node < n);
+		assert(index_classes);
+		return FindClassRun(class_out, out_offset, node, c, count);
+	}
+
+	/**
+	* @brief Gets the in neighbors of a node with a given class.
+	* @note The class index must have been built.
+	* @param [in] node Node id.
+	* @param [in] c Class.
+	* @param [out] count Number of neighbors of the class.
+	* @returns The neighbors of the class, by increasing id.
+	*/
+	template <typename Node, typename Edge>
+	inline const nodeID_t* ARGraph<Node, Edge>::GetInEdgesOfClass(nodeID_t node,
+		uint32_t c, uint32_t &count) const
+	{
+		assert(node < n);
+		assert(index_classes);
+		return FindClassRun(class_in, in_offset, node, c, count);
+	}
+
+	/**
+	* @brief Binary search of a node in a sorted set of neighboors.
+	* @param [in] set First element of the set.
+	* @param [in] count Number of elements of the set.
+	* @param [in] node Node id to look for.
+	* @param [out] index Index of the node in the set.
+	* @retval TRUE If the node belongs to the set.
+	* @retval FALSE If the node doesn't belong to the set.
+	*/
+	template <typename Node, typename Edge>
+	inline bool ARGraph<Node, Edge>::FindNode(const nodeID_t* set, uint32_t count,
+		nodeID_t node, nodeID_t &index)
+	{
+		uint32_t a, b, c;
+
 		a = 0;
-		b = out[n1].size();
+		b = count;
 		while (a < b)
 		{
-			c = (unsigned)(a + b) >> 1;
-			if (out[n1][c] < n2)
+			c = (a + b) >> 1;
+			if (set[c] < node)
 				a = c + 1;
-			else if (out[n1][c] > n2)
+			else if (set[c] > node)
 				b = c;
 			else
 			{
@@ -324,6 +719,42 @@ namespace vflib
 		return false;
 	}
 
+	/**
+	* @brief Gets the index of node n2 in the out neighboors set of n1.
+	* @param [in] n1 First node id.
+	* @param [in] n2 Second node id.
+	* @param [out] index Index of the node n2 in the neighboors set of n1.
+	* @retval TRUE If the the nodes n2 is a neighboor of n1.
+	* @retval FALSE If the the nodes n2 isn't a neighboor of n1.
+	*/
+	template <typename Node, typename Edge>
+	inline bool ARGraph<Node, Edge>::GetNodeIndex(nodeID_t n1, nodeID_t n2, nodeID_t &index) const
+	{
+		assert(n1 < n);
+		assert(n2 < n);
+
+		return FindNode(out_nodes + out_offset[n1],
+			out_offset[n1 + 1] - out_offset[n1], n2, index);
+	}
+
+	/**
+	* @brief Gets the index of node n2 in the in neighboors set of n1.
+	* @param [in] n1 First node id.
+	* @param [in] n2 Second node id.
+	* @param [out] index Index of the node n2 in the in neighboors set of n1.
+	* @retval TRUE If the the nodes n2 is an in neighboor of n1.
+	* @retval FALSE If the the nodes n2 isn't an in neighboor of n1.
+	*/
+	template <typename Node, typename Edge>
+	inline bool ARGraph<Node, Edge>::GetInNodeIndex(nodeID_t n1, nodeID_t n2, nodeID_t &index) const
+	{
+		assert(n1 < n);
+		assert(n2 < n);
+
+		return FindNode(in_nodes + in_offset[n1],
+			in_offset[n1 + 1] - in_offset[n1], n2, index);
+	}
+
 	/**
 	* @brief Gets the attribute of an edge.
 	* @note The method assumes that the edge exists.
@@ -335,8 +766,9 @@ namespace vflib
 	inline Edge& ARGraph<Node, Edge>::GetEdgeAttr(nodeID_t n1, nodeID_t n2)
 	{
 		nodeID_t index;
-		assert(GetNodeIndex(n1, n2, index) == true);
-		return out_attr[n1][index];
+		bool found = GetNodeIndex(n1, n2, index);
+		assert(found);
+		return out_attr[AttrIndex(out_offset[n1] + index)];
 	}
 
 	/**
@@ -348,7 +780,7 @@ namespace vflib
 	inline uint32_t ARGraph<Node, Edge>::InEdgeCount(nodeID_t node) const
 	{
 		assert(node < n);
-		return (int)in[node].size();
+		return in_offset[node + 1] - in_offset[node];
 	}
 
 
@@ -361,7 +793,7 @@ namespace vflib
 	inline uint32_t ARGraph<Node, Edge>::OutEdgeCount(nodeID_t node) const
 	{
 		assert(node < n);
-		return (int)out[node].size();
+		return out_offset[node + 1] - out_offset[node];
 	}
 
 	/**
@@ -373,7 +805,7 @@ namespace vflib
 	inline uint32_t ARGraph<Node, Edge>::EdgeCount(nodeID_t node) const
 	{
 		assert(node < n);
-		return in[node].size() + out[node].size();
+		return InEdgeCount(node) + OutEdgeCount(node);
 	}
 
 	/**
@@ -386,10 +818,8 @@ namespace vflib
 	inline nodeID_t ARGraph<Node, Edge>::GetInEdge(nodeID_t node, uint32_t i) const
 	{
 		assert(node < n);
-		assert(i < in[node].size());
-		if (node == 2 && i == 0)
-			return in[node][i];
-		return in[node][i];
+		assert(i < InEdgeCount(node));
+		return in_nodes[in_offset[node] + i];
 	}
 
 	/**
@@ -404,9 +834,9 @@ namespace vflib
 		Edge& pattr) const
 	{
 		assert(node < n);
-		assert(i < in[node].size());
-		pattr = in_attr[node][i];
-		return in[node][i];
+		assert(i < InEdgeCount(node));
+		pattr = in_attr[AttrIndex(in_offset[node] + i)];
+		return in_nodes[in_offset[node] + i];
 	}
 
 	/**
@@ -419,8 +849,8 @@ namespace vflib
 	inline nodeID_t ARGraph<Node, Edge>::GetOutEdge(nodeID_t node, uint32_t i) const
 	{
 		assert(node < n);
-		assert(i < out[node].size());
-		return out[node][i];
+		assert(i < OutEdgeCount(node));
+		return out_nodes[out_offset[node] + i];
 	}
 
 	/**
@@ -435,9 +865,9 @@ namespace vflib
 		Edge& pattr) const
 	{
 		assert(node < n);
-		assert(i < out[node].size());
-		pattr = out_attr[node][i];
-		return out[node][i];
+		assert(i < OutEdgeCount(node));
+		pattr = out_attr[AttrIndex(out_offset[node] + i)];
+		return out_nodes[out_offset[node] + i];
 	}
 
 	/**
@@ -460,7 +890,7 @@ namespace vflib
 	template <typename Node, typename Edge>
 	inline nodeID_t* ARGraph<Node, Edge>::GetOutEdgeSet(nodeID_t node)
 	{
-		return out[node].data();
+		return out_nodes + out_offset[node];
 	}
 
 	/**
@@ -471,7 +901,7 @@ namespace vflib
 	template <typename Node, typename Edge>
 	inline nodeID_t* ARGraph<Node, Edge>::GetInEdgeSet(nodeID_t node)
 	{
-		return in[node].data();
+		return in_nodes + in_offset[node];
 	}
 
 	/*-------------------------------------------------------------------
@@ -497,8 +927,12 @@ namespace vflib
 	bool ARGraph<Node, Edge>::HasEdge(nodeID_t n1, nodeID_t n2, Edge &pattr) const
 	{
 		nodeID_t index;
+		if (!EdgeAttrTraits<Edge>::stored)
+			return HasEdge(n1, n2);
+		if (!TestAdjacencyBit(n1, n2))
+			return false;
 		if (GetNodeIndex(n1, n2, index)) {
-			pattr = out_attr[n1][index];
+			pattr = out_attr[out_offset[n1] + index];
 			return true;
 		}
 		return false;
@@ -519,10 +953,10 @@ namespace vflib
 		assert(n2 < n);
 
 		if (GetNodeIndex(n1, n2, c))
-			out_attr[n1][c] = new_attr;
+			out_attr[AttrIndex(out_offset[n1] + c)] = new_attr;
 
-		if (GetNodeIndex(n2, n1, c))
-			in_attr[n2][c] = new_attr;
+		if (GetInNodeIndex(n2, n1, c))
+			in_attr[AttrIndex(in_offset[n2] + c)] = new_attr;
 	}
 
 	/**
@@ -536,9 +970,9 @@ namespace vflib
 		param_type param)
 	{
 		assert(node < n);
-		size_t i;
-		for (i = 0; i < in[node].size(); i++)
-			vis(this, in[node][i], node, in_attr[node][i], param);
+		uint32_t i;
+		for (i = in_offset[node]; i < in_offset[node + 1]; i++)
+			vis(this, in_nodes[i], node, &in_attr[AttrIndex(i)], param);
 	}
 
 	/**
@@ -552,9 +986,9 @@ namespace vflib
 		param_type param)
 	{
 		assert(node < n);
-		size_t i;
-		for (i = 0; i < out[node].size(); i++)
-			vis(this, node, out[node][i], out_attr[node][i], param);
+		uint32_t i;
+		for (i = out_offset[node]; i < out_offset[node + 1]; i++)
+			vis(this, node, out_nodes[i], &out_attr[AttrIndex(i)], param);
 	}
 
 	/**
@@ -571,96 +1005,386 @@ namespace vflib
 	}
 
 	/**
-	* @brief Constructs the graph form a loader.
-	* @param loader ARGLoader
+	* @brief Counts the distinct values in a vector.
+	* @note The vector is sorted in place. Only operator< is required.
+	* @param [in,out] values Values to count.
+	* @returns Number of distinct values.
 	*/
 	template <typename Node, typename Edge>
-	ARGraph<Node, Edge>::ARGraph(ARGLoader<Node, Edge> *loader)
+	template <typename T>
+	uint32_t ARGraph<Node, Edge>::CountDistinct(std::vector<T> &values)
 	{
-		n = loader->NodeCount();
-                attr.resize(n);
-                in.resize(n);
-                in_attr.resize(n);
-                out.resize(n);
-                out_attr.resize(n);
+		size_t i;
+		uint32_t count;
 
-		e_count = 0;
-		e_out_count = 0;
-		e_in_count = 0;
-		n_attr_count = 0;
-		e_attr_count = 0;
-		std::map<Node, bool> attributemap;
-		std::map<Edge, bool> e_attributemap;
+		if (values.empty())
+			return 0;
 
-		max_deg_in = max_deg_out = max_degree = 0;
+		std::sort(values.begin(), values.end());
+		count = 1;
+		for (i = 1; i < values.size(); i++)
+			if (values[i - 1] < values[i])
+				count++;
+		return count;
+	}
 
-                std::vector< std::map< nodeID_t, Edge> > revmap;
-                typename std::map< nodeID_t, Edge>::iterator rvit;
-                revmap.resize(n);
+	/**
+	* @brief Sorts by node id the neighbors of a node and drops the duplicates.
+	* @details The row is moved to start at dest, that must not follow begin.
+	* Of the copies of an edge the last one is kept, with its attribute.
+	* @param [in,out] nodes Neighbors of all the nodes.
+	* @param [in,out] attrs Attributes parallel to nodes, unused if not stored.
+	* @param [in] begin First neighbor of the node.
+	* @param [in] end End of the neighbors of the node.
+	* @param [in] dest New position of the first neighbor.
+	* @returns New end of the neighbors of the node.
+	*/
+	template <typename Node, typename Edge>
+	uint32_t ARGraph<Node, Edge>::CompactRow(nodeID_t *nodes, Edge *attrs,
+		uint32_t begin, uint32_t end, uint32_t dest)
+	{
+		uint32_t i;
 
-		uint32_t i, j;
-		for (i = 0; i < n; i++)
+		for (i = begin + 1; i < end && nodes[i - 1] < nodes[i]; i++)
+			;
+		if (i >= end)
 		{
-			Node attribute = loader->GetNodeAttr(i);
-			attr[i]=(attribute);
-
-			if(!attributemap.count(attribute))
-			{ 
-				attributemap[attribute]=true;
-				n_attr_count++;
+			//Already sorted and without duplicates
+			if (dest == begin)
+				return end;
+			for (i = begin; i < end; i++, dest++)
+			{
+				nodes[dest] = nodes[i];
+				if (EdgeAttrTraits<Edge>::stored)
+					attrs[dest] = attrs[i];
 			}
+			return dest;
 		}
 
+		if (!EdgeAttrTraits<Edge>::stored)
+		{
+			std::sort(nodes + begin, nodes + end);
+			end = (uint32_t)(std::unique(nodes + begin, nodes + end) - nodes);
+			for (i = begin; i < end; i++, dest++)
+				nodes[dest] = nodes[i];
+			return dest;
+		}
+
+		std::vector<std::pair<nodeID_t, uint32_t> > row(end - begin);
+		for (i = begin; i < end; i++)
+			row[i - begin] = std::make_pair(nodes[i], i);
+		std::sort(row.begin(), row.end());
+
+		EdgeAttrVector row_attr(attrs + begin, attrs + end);
+		for (i = 0; i < row.size(); i++)
+		{
+			if (i + 1 < row.size() && row[i + 1].first == row[i].first)
+				continue;
+			nodes[dest] = row[i].first;
+			attrs[dest] = row_attr[row[i].second - begin];
+			dest++;
+		}
+		return dest;
+	}
+
+	/**
+	* @brief Checks the edges of one direction, sorts them and drops the duplicates.
+	* @param [in] n Number of nodes.
+	* @param [in,out] offset Start of the neighbors of each node (n+1 entries).
+	* @param [in,out] nodes Neighbors of the nodes.
+	* @param [in,out] attrs Attributes parallel to nodes, empty if not stored.
+	* @param [in] direction Name of the direction for the error messages.
+	*/
+	template <typename Node, typename Edge>
+	void ARGraph<Node, Edge>::CompactEdges(uint32_t n, std::vector<uint32_t> &offset,
+		std::vector<nodeID_t> &nodes, std::vector<Edge> &attrs, const char *direction)
+	{
+		uint32_t i, j, begin, dest;
+
+		if (offset.size() != (size_t)n + 1 || offset[0] != 0 || nodes.size() != offset[n] ||
+			(EdgeAttrTraits<Edge>::stored && attrs.size() != nodes.size()))
+			error("Inconsistent graph data: wrong size of the %s edge arrays", direction);
 		for (i = 0; i < n; i++)
 		{
-			uint32_t k = loader->OutEdgeCount(i);
-			e_out_count += k;
+			if (offset[i] > offset[i + 1])
+				error("Inconsistent graph data: decreasing %s offsets at node %u", direction, i);
+			for (j = offset[i]; j < offset[i + 1]; j++)
+				if (nodes[j] >= n)
+					error("Inconsistent graph data: %s edge %u %u out of range", direction, i, nodes[j]);
+		}
 
-			if (k > max_deg_out)
-				max_deg_out = k;
-                        out[i].resize(k);
-                        out_attr[i].resize(k);
+		dest = 0;
+		for (i = 0; i < n; i++)
+		{
+			begin = offset[i];
+			offset[i] = dest;
+			dest = CompactRow(nodes.data(), attrs.data(), begin, offset[i + 1], dest);
+		}
+		offset[n] = dest;
+		nodes.resize(dest);
+		if (EdgeAttrTraits<Edge>::stored)
+			attrs.resize(dest);
+	}
 
-			for (j = 0; j < k; j++)
-			{
-				nodeID_t n2 = loader->GetOutEdge(i, j,
-                                                     &out_attr[i][j]);
-				out[i][j]=n2;
-                                revmap[n2][i]=out_attr[i][j];
-			}
+	/**
+	* @brief Points the arrays of the graph to the ones it owns.
+	*/
+	template <typename Node, typename Edge>
+	void ARGraph<Node, Edge>::BindData()
+	{
+		attr = data.attr.data();
+		in_offset = data.in_offset.data();
+		out_offset = data.out_offset.data();
+		in_nodes = data.in_nodes.data();
+		out_nodes = data.out_nodes.data();
+		in_attr = data.in_attr.data();
+		out_attr = data.out_attr.data();
+		if (!EdgeAttrTraits<Edge>::stored)
+			in_attr = out_attr = &no_attr;
+	}
+
+	/**
+	* @brief Constructs the graph on top of arrays it doesn't own.
+	* @note Nothing is copied: the arrays must outlive the graph,
+	* unless the view has an owner that keeps them alive.
+	* @param view ARGraphView
+	*/
+	template <typename Node, typename Edge>
+	ARGraph<Node, Edge>::ARGraph(const ARGraphView<Node, Edge> &view)
+	{
+		n = view.n;
+		e_count = view.e_count;
+		e_in_count = view.e_in_count;
+		e_out_count = view.e_out_count;
+		max_deg_in = view.max_deg_in;
+		max_deg_out = view.max_deg_out;
+		max_degree = view.max_degree;
+		n_attr_count = view.n_attr_count;
+		e_attr_count = view.e_attr_count;
+		adj_words = 0;
+		index_classes = NULL;
+
+		attr = view.attr;
+		in_offset = view.in_offset;
+		out_offset = view.out_offset;
+		in_nodes = view.in_nodes;
+		out_nodes = view.out_nodes;
+		in_attr = view.in_attr;
+		out_attr = view.out_attr;
+		if (!EdgeAttrTraits<Edge>::stored)
+			in_attr = out_attr = &no_attr;
+		owner = view.owner;
+	}
+
+	/**
+	* @brief Copies a graph.
+	* @see operator=
+	*/
+	template <typename Node, typename Edge>
+	ARGraph<Node, Edge>::ARGraph(const ARGraph &g)
+	{
+		*this = g;
+	}
+
+	/**
+	* @brief Copies a graph.
+	* @details The arrays owned by the graph are copied. The arrays of a
+	* graph built on a view are shared by the copy, that keeps their owner
+	* alive too.
+	*/
+	template <typename Node, typename Edge>
+	ARGraph<Node, Edge>& ARGraph<Node, Edge>::operator=(const ARGraph &g)
+	{
+		if (this == &g)
+			return *this;
+
+		n = g.n;
+		n_attr_count = g.n_attr_count;
+		e_attr_count = g.e_attr_count;
+		e_count = g.e_count;
+		e_out_count = g.e_out_count;
+		e_in_count = g.e_in_count;
+		max_deg_in = g.max_deg_in;
+		max_deg_out = g.max_deg_out;
+		max_degree = g.max_degree;
+		data = g.data;
+		owner = g.owner;
+		adj_bits = g.adj_bits;
+		adj_row = g.adj_row;
+		adj_words = g.adj_words;
+		class_out = g.class_out;
+		class_in = g.class_in;
+		index_classes = g.index_classes;
+
+		//An owned graph always has its out offsets, a view has none
+		if (!data.out_offset.empty())
+		{
+			BindData();
+			return *this;
 		}
 
+		attr = g.attr;
+		in_offset = g.in_offset;
+		out_offset = g.out_offset;
+		in_nodes = g.in_nodes;
+		out_nodes = g.out_nodes;
+		in_attr = g.in_attr;
+		out_attr = g.out_attr;
+		if (!EdgeAttrTraits<Edge>::stored)
+			in_attr = out_attr = &no_attr;
+		return *this;
+	}
+
+	/**
+	* @brief Takes ownership of the arrays and derives everything else.
+	* @details The out edges of each node are sorted if needed, and the
+	* duplicated ones dropped; the in edges are built by scattering the
+	* out edges, visiting the sources in increasing order so that each row
+	* comes out already sorted, unless they have been provided too.
+	*/
+	template <typename Node, typename Edge>
+	void ARGraph<Node, Edge>::AdoptData()
+	{
+		uint32_t i, j;
+
+		n = (uint32_t)data.attr.size();
+		if (!EdgeAttrTraits<Edge>::stored)
+		{
+			EdgeAttrVector().swap(data.in_attr);
+			EdgeAttrVector().swap(data.out_attr);
+		}
+		CompactEdges(n, data.out_offset, data.out_nodes, data.out_attr, "out");
+
+		e_count = 0;
+		e_in_count = 0;
+		e_out_count = data.out_offset[n];
+		max_deg_in = max_deg_out = max_degree = 0;
+		adj_words = 0;
+		index_classes = NULL;
+
+		bool has_in_edges = !data.in_offset.empty();
+		if (!has_in_edges)
+			data.in_offset.assign(n + 1, 0);
+		else
+			CompactEdges(n, data.in_offset, data.in_nodes, data.in_attr, "in");
+		BindData();
+
 		for (i = 0; i < n; i++)
 		{
-			uint32_t k = revmap[i].size();
-			e_in_count += k;
+			uint32_t k = out_offset[i + 1] - out_offset[i];
+			if (k > max_deg_out)
+				max_deg_out = k;
 
-			if (k > max_deg_in)
-				max_deg_in = k;
-                        
-                        in[i].resize(k);
-                        in_attr[i].resize(k);
-
-			for (j = 0, rvit=revmap[i].begin(); j < k; j++, rvit++)
-			{ in[i][j] = rvit->first;
-                          Edge edge_attr=rvit->second;
-                          in_attr[i][j]=edge_attr;
-			  if(!e_attributemap.count(edge_attr)) { 
-				e_attributemap[edge_attr]=true;
-				e_attr_count++;
-			  }
-			}
+			for (j = out_offset[i]; j < out_offset[i + 1] && !has_in_edges; j++)
+				in_offset[out_nodes[j] + 1]++;
+		}
 
+		if (!has_in_edges)
+		{
+			for (i = 0; i < n; i++)
+				in_offset[i + 1] += in_offset[i];
+			data.in_nodes.resize(in_offset[n]);
+			if (EdgeAttrTraits<Edge>::stored)
+				data.in_attr.resize(in_offset[n]);
+			BindData();
+
+			OffsetVec pos(in_offset, in_offset + n);
+			for (i = 0; i < n; i++)
+			{
+				for (j = out_offset[i]; j < out_offset[i + 1]; j++)
+				{
+					uint32_t e = pos[out_nodes[j]]++;
+					in_nodes[e] = i;
+					in_attr[AttrIndex(e)] = out_attr[AttrIndex(j)];
+				}
+			}
 		}
+		e_in_count = in_offset[n];
 
 		for (i = 0; i < n; i++) {
-			uint32_t count = in[i].size() + out[i].size();
+			uint32_t k = InEdgeCount(i);
+			if (k > max_deg_in)
+				max_deg_in = k;
+			uint32_t count = EdgeCount(i);
 			e_count += count;
 			if (count > max_degree) {
 				max_degree = count;
 			}
 		}
 
+		{
+			NodeAttrVector node_attrs(attr, attr + n);
+			n_attr_count = CountDistinct(node_attrs);
+		}
+		if (EdgeAttrTraits<Edge>::stored)
+		{
+			EdgeAttrVector edge_attrs(out_attr, out_attr + e_out_count);
+			e_attr_count = CountDistinct(edge_attrs);
+		}
+		else
+			e_attr_count = e_out_count ? 1 : 0;
+	}
+
+	/**
+	* @brief Constructs the graph by taking over the arrays of graph_data.
+	* @details This is the way for an application keeping its graphs in
+	* CSR form to build an ARGraph without copying them: the vectors are
+	* moved in, not copied. Only attr, out_offset, out_nodes and out_attr
+	* are required; if in_offset is empty the in edges are derived from
+	* the out edges.
+	* @param graph_data Arrays of the graph, left empty.
+	*/
+	template <typename Node, typename Edge>
+	ARGraph<Node, Edge>::ARGraph(ARGraphData<Node, Edge> &&graph_data)
+		: data(std::move(graph_data))
+	{
+		AdoptData();
+	}
+
+	/**
+	* @brief Constructs the graph form a loader.
+	* @details If the loader can release its arrays they are adopted
+	* as they are. Otherwise the out edges are read from the loader
+	* straight into their CSR arrays, without any per edge allocation.
+	* @param loader ARGLoader
+	*/
+	template <typename Node, typename Edge>
+	ARGraph<Node, Edge>::ARGraph(ARGLoader<Node, Edge> *loader)
+	{
+		uint32_t i, j, e;
+
+		if (loader->ReleaseGraphData(data))
+		{
+			AdoptData();
+			return;
+		}
+
+		n = loader->NodeCount();
+		data.attr.resize(n);
+		data.out_offset.resize(n + 1);
+
+		//Out edges offsets are known in advance from the loader
+		e = 0;
+		for (i = 0; i < n; i++)
+		{
+			data.attr[i] = loader->GetNodeAttr(i);
+			data.out_offset[i] = e;
+			e += loader->OutEdgeCount(i);
+		}
+		data.out_offset[n] = e;
+		data.out_nodes.resize(e);
+		if (EdgeAttrTraits<Edge>::stored)
+			data.out_attr.resize(e);
+
+		for (i = 0; i < n; i++)
+		{
+			e = data.out_offset[i];
+			for (j = 0; e < data.out_offset[i + 1]; j++, e++)
+				data.out_nodes[e] = loader->GetOutEdge(i, j,
+					EdgeAttrTraits<Edge>::stored ? &data.out_attr[e] : &no_attr);
+		}
+
+		AdoptData();
 	}
 
 }
@@ -0,0 +1,333 @@
+/**
+ * @file   ARGraphSnapshot.hpp
+ * @brief  Binary snapshot of an ARGraph that can be memory mapped.
+ * @details The snapshot mirrors the flat layout of ARGraph: a header
+ * with the precomputed statistics of the graph, followed by the node
+ * attributes, the offsets and the neighbors of the in and out edges and
+ * the edge attributes. Every section starts at a multiple of 8 bytes.
+ * Values are stored in the byte order of the machine that wrote the
+ * snapshot, so a snapshot can't be moved across different endianness.
+ *
+ * Loading a snapshot maps the file and builds the graph on top of the
+ * mapped pages: nothing is parsed or copied, and the pages of the page
+ * cache are shared among the processes mapping the same file. The
+ * mapping is private, so changes to the attributes are never written back.
+ *
+ * Only node and edge attributes that are trivially copyable can be
+ * stored in a snapshot. Edge attributes that are not stored in the
+ * graph (see EdgeAttrTraits) take no space in the snapshot either.
+ */
+
+#ifndef ARGRAPHSNAPSHOT_HPP
+#define ARGRAPHSNAPSHOT_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+#include "ARGraph.hpp"
+#include "MappedFile.hpp"
+
+namespace vflib
+{
+	const char SNAPSHOT_MAGIC[8] = { 'V', 'F', '3', 'S', 'N', 'A', 'P', '\0' };	/**<Magic string of the snapshot files */
+	const uint32_t SNAPSHOT_VERSION = 2;			/**<Version of the snapshot format */
+	const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;	/**<Marker used to detect a different byte order */
+
+	/**
+	* @struct ARGraphSnapshotHeader
+	* @brief Header of a snapshot file.
+	* @details Section offsets are in bytes from the beginning of the file.
+	*/
+	struct ARGraphSnapshotHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t node_attr_size;                  /**<sizeof of the node attribute */
+		uint32_t edge_attr_size;                  /**<sizeof of the edge attribute, 0 if not stored */
+		uint32_t n;
+		uint32_t e_count;
+		uint32_t e_in_count;
+		uint32_t e_out_count;
+		uint32_t max_deg_in;
+		uint32_t max_deg_out;
+		uint32_t max_degree;
+		uint32_t n_attr_count;
+		uint32_t e_attr_count;
+		uint32_t reserved;
+		uint64_t attr_offset;
+		uint64_t in_offset_offset;
+		uint64_t out_offset_offset;
+		uint64_t in_nodes_offset;
+		uint64_t out_nodes_offset;
+		uint64_t in_attr_offset;
+		uint64_t out_attr_offset;
+		uint64_t file_size;
+	};
+
+	/**
+	* @brief Rounds a section offset up to the next multiple of 8 bytes.
+	*/
+	inline uint64_t SnapshotAlign(uint64_t offset)
+	{
+		return (offset + 7) & ~(uint64_t)7;
+	}
+
+	/**
+	* @brief Checks that the attributes of a graph can be stored in a snapshot.
+	*/
+	template <typename Node, typename Edge>
+	inline void CheckSnapshotAttributes()
+	{
+		if (!std::is_trivially_copyable<Node>::value || !std::is_trivially_copyable<Edge>::value)
+			error("Snapshots require trivially copyable node and edge attributes");
+	}
+
+	/**
+	* @brief Size of an edge attribute in a snapshot.
+	*/
+	template <typename Edge>
+	inline uint32_t SnapshotEdgeAttrSize()
+	{
+		return EdgeAttrTraits<Edge>::stored ? (uint32_t)sizeof(Edge) : 0;
+	}
+
+	/**
+	* @brief Checks that a section of a snapshot is aligned and inside the file.
+	*/
+	inline bool SnapshotSectionFits(uint64_t offset, uint64_t bytes, uint64_t size)
+	{
+		return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+	}
+
+	/**
+	* @brief Checks the edges of a snapshot in one direction.
+	* @details The offsets must start from 0, never decrease and end at the
+	* number of edges, and the neighbors of each node must be sorted node ids.
+	* Reads all the mapped pages of the section once, so it is only done
+	* on request, see MapARGraphSnapshot.
+	* @param [in] offset Offsets of the edges of each node (n+1 entries).
+	* @param [in] nodes Neighbors of the nodes.
+	* @param [in] n Number of nodes.
+	* @param [in] count Number of edges.
+	* @returns TRUE if the edges are valid.
+	*/
+	inline bool CheckSnapshotEdges(const uint32_t* offset, const nodeID_t* nodes, uint32_t n, uint32_t count)
+	{
+		uint32_t i, j;
+
+		if (offset[0] != 0 || offset[n] != count)
+			return false;
+		for (i = 0; i < n; i++)
+		{
+			if (offset[i] > offset[i + 1] || offset[i + 1] > count)
+				return false;
+			for (j = offset[i]; j < offset[i + 1]; j++)
+				if (nodes[j] >= n || (j > offset[i] && nodes[j - 1] > nodes[j]))
+					return false;
+		}
+		return true;
+	}
+
+	/**
+	* @brief Writes a section of a snapshot at its offset.
+	*/
+	inline void WriteSnapshotSection(FILE *f, uint64_t offset, const void *data, size_t size,
+		const std::string &filename)
+	{
+		static const char padding[8] = { 0 };
+		long pos = ftell(f);
+
+		if (pos < 0 || (uint64_t)pos > offset)
+			error("Unable to write snapshot %s", filename.c_str());
+		if ((uint64_t)pos < offset && fwrite(padding, 1, (size_t)(offset - pos), f) != offset - pos)
+			error("Unable to write snapshot %s", filename.c_str());
+		if (size && fwrite(data, 1, size, f) != size)
+			error("Unable to write snapshot %s", filename.c_str());
+	}
+
+	/**
+	* @brief Writes the snapshot of a graph.
+	* @param [in] g Graph to store.
+	* @param [in] filename Name of the snapshot file.
+	*/
+	template <typename Node, typename Edge>
+	void WriteARGraphSnapshot(ARGraph<Node, Edge> &g, const std::string &filename)
+	{
+		ARGraphSnapshotHeader h;
+		uint32_t i, j;
+		nodeID_t node;
+
+		CheckSnapshotAttributes<Node, Edge>();
+
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+		h.version = SNAPSHOT_VERSION;
+		h.byte_order = SNAPSHOT_BYTE_ORDER;
+		h.node_attr_size = sizeof(Node);
+		h.edge_attr_size = SnapshotEdgeAttrSize<Edge>();
+		h.n = g.NodeCount();
+		h.e_count = g.EdgeCount();
+		h.e_in_count = g.InEdgeCount();
+		h.e_out_count = g.OutEdgeCount();
+		h.max_deg_in = g.InMaxDegree();
+		h.max_deg_out = g.OutMaxDegree();
+		h.max_degree = g.MaxDegree();
+		h.n_attr_count = g.NodeAttrCount();
+		h.e_attr_count = g.EdgeAttrCount();
+
+		h.attr_offset = SnapshotAlign(sizeof(h));
+		h.in_offset_offset = SnapshotAlign(h.attr_offset + (uint64_t)h.n * sizeof(Node));
+		h.out_offset_offset = SnapshotAlign(h.in_offset_offset + ((uint64_t)h.n + 1) * sizeof(uint32_t));
+		h.in_nodes_offset = SnapshotAlign(h.out_offset_offset + ((uint64_t)h.n + 1) * sizeof(uint32_t));
+		h.out_nodes_offset = SnapshotAlign(h.in_nodes_offset + (uint64_t)h.e_in_count * sizeof(nodeID_t));
+		h.in_attr_offset = SnapshotAlign(h.out_nodes_offset + (uint64_t)h.e_out_count * sizeof(nodeID_t));
+		h.out_attr_offset = SnapshotAlign(h.in_attr_offset + (uint64_t)h.e_in_count * h.edge_attr_size);
+		h.file_size = SnapshotAlign(h.out_attr_offset + (uint64_t)h.e_out_count * h.edge_attr_size);
+
+		FILE *f = fopen(filename.c_str(), "wb");
+		if (!f)
+			error("Unable to open snapshot %s", filename.c_str());
+
+		WriteSnapshotSection(f, 0, &h, sizeof(h), filename);
+
+		std::vector<Node> attr(h.n);
+		for (node = 0; node < h.n; node++)
+			attr[node] = g.GetNodeAttr(node);
+		WriteSnapshotSection(f, h.attr_offset, attr.data(), attr.size() * sizeof(Node), filename);
+
+		std::vector<uint32_t> offset(h.n + 1);
+		offset[0] = 0;
+		for (node = 0; node < h.n; node++)
+			offset[node + 1] = offset[node] + g.InEdgeCount(node);
+		WriteSnapshotSection(f, h.in_offset_offset, offset.data(), offset.size() * sizeof(uint32_t), filename);
+		for (node = 0; node < h.n; node++)
+			offset[node + 1] = offset[node] + g.OutEdgeCount(node);
+		WriteSnapshotSection(f, h.out_offset_offset, offset.data(), offset.size() * sizeof(uint32_t), filename);
+
+		WriteSnapshotSection(f, h.in_nodes_offset, NULL, 0, filename);
+		for (node = 0; node < h.n; node++)
+			WriteSnapshotSection(f, ftell(f), g.GetInEdgeSet(node), g.InEdgeCount(node) * sizeof(nodeID_t), filename);
+		WriteSnapshotSection(f, h.out_nodes_offset, NULL, 0, filename);
+		for (node = 0; node < h.n; node++)
+			WriteSnapshotSection(f, ftell(f), g.GetOutEdgeSet(node), g.OutEdgeCount(node) * sizeof(nodeID_t), filename);
+
+		std::vector<Edge> edge_attr;
+		WriteSnapshotSection(f, h.in_attr_offset, NULL, 0, filename);
+		for (node = 0; node < h.n && h.edge_attr_size; node++)
+		{
+			edge_attr.resize(g.InEdgeCount(node));
+			for (i = 0; i < edge_attr.size(); i++)
+				g.GetInEdge(node, i, edge_attr[i]);
+			WriteSnapshotSection(f, ftell(f), edge_attr.data(), edge_attr.size() * sizeof(Edge), filename);
+		}
+		WriteSnapshotSection(f, h.out_attr_offset, NULL, 0, filename);
+		for (node = 0; node < h.n && h.edge_attr_size; node++)
+		{
+			edge_attr.resize(g.OutEdgeCount(node));
+			for (j = 0; j < edge_attr.size(); j++)
+				g.GetOutEdge(node, j, edge_attr[j]);
+			WriteSnapshotSection(f, ftell(f), edge_attr.data(), edge_attr.size() * sizeof(Edge), filename);
+		}
+		WriteSnapshotSection(f, h.file_size, NULL, 0, filename);
+
+		if (fclose(f))
+			error("Unable to write snapshot %s", filename.c_str());
+	}
+
+	/**
+	* @brief Writes the snapshot of the graph provided by a loader.
+	* @param [in] loader Loader of the graph.
+	* @param [in] filename Name of the snapshot file.
+	*/
+	template <typename Node, typename Edge>
+	void WriteARGraphSnapshot(ARGLoader<Node, Edge> *loader, const std::string &filename)
+	{
+		ARGraph<Node, Edge> g(loader);
+		WriteARGraphSnapshot(g, filename);
+	}
+
+	/**
+	* @brief Maps a snapshot file in memory.
+	* @details The returned view owns the mapping, that is released
+	* when the last graph built on it is destroyed.
+	* The header, the layout of the sections and the bounds of the edge
+	* offsets are always checked, without touching the edge sections.
+	* The full check of every offset and neighbor id reads the whole
+	* file: vf3snap does it once, when the snapshot is written.
+	* @param [in] filename Name of the snapshot file.
+	* @param [in] verify If TRUE, all the edges are checked too.
+	* @returns View of the graph, to be passed to the ARGraph constructor.
+	*/
+	template <typename Node, typename Edge>
+	ARGraphView<Node, Edge> MapARGraphSnapshot(const std::string &filename, bool verify = false)
+	{
+		ARGraphView<Node, Edge> view;
+		ARGraphSnapshotHeader h;
+		uint64_t size;
+		char *base;
+
+		CheckSnapshotAttributes<Node, Edge>();
+
+		std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(filename, true);
+		base = file->Data();
+		size = file->Size();
+		if (size < sizeof(h))
+			error("Invalid snapshot %s", filename.c_str());
+		view.owner = file;
+
+		memcpy(&h, base, sizeof(h));
+		if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) || h.version != SNAPSHOT_VERSION)
+			error("Invalid snapshot %s", filename.c_str());
+		if (h.byte_order != SNAPSHOT_BYTE_ORDER)
+			error("Snapshot %s has a different byte order", filename.c_str());
+		if (h.node_attr_size != sizeof(Node) || h.edge_attr_size != SnapshotEdgeAttrSize<Edge>())
+			error("Snapshot %s has different attribute types", filename.c_str());
+		if (h.file_size != size ||
+			!SnapshotSectionFits(h.attr_offset, (uint64_t)h.n * h.node_attr_size, size) ||
+			!SnapshotSectionFits(h.in_offset_offset, ((uint64_t)h.n + 1) * sizeof(uint32_t), size) ||
+			!SnapshotSectionFits(h.out_offset_offset, ((uint64_t)h.n + 1) * sizeof(uint32_t), size) ||
+			!SnapshotSectionFits(h.in_nodes_offset, (uint64_t)h.e_in_count * sizeof(nodeID_t), size) ||
+			!SnapshotSectionFits(h.out_nodes_offset, (uint64_t)h.e_out_count * sizeof(nodeID_t), size) ||
+			!SnapshotSectionFits(h.in_attr_offset, (uint64_t)h.e_in_count * h.edge_attr_size, size) ||
+			!SnapshotSectionFits(h.out_attr_offset, (uint64_t)h.e_out_count * h.edge_attr_size, size))
+			error("Truncated snapshot %s", filename.c_str());
+
+		const uint32_t *in_offset = (const uint32_t*)(base + h.in_offset_offset);
+		const uint32_t *out_offset = (const uint32_t*)(base + h.out_offset_offset);
+		if (in_offset[0] != 0 || in_offset[h.n] != h.e_in_count ||
+			out_offset[0] != 0 || out_offset[h.n] != h.e_out_count)
+			error("Corrupted edges in snapshot %s", filename.c_str());
+		if (verify &&
+			(!CheckSnapshotEdges(in_offset, (const nodeID_t*)(base + h.in_nodes_offset), h.n, h.e_in_count) ||
+			!CheckSnapshotEdges(out_offset, (const nodeID_t*)(base + h.out_nodes_offset), h.n, h.e_out_count)))
+			error("Corrupted edges in snapshot %s", filename.c_str());
+
+		view.n = h.n;
+		view.e_count = h.e_count;
+		view.e_in_count = h.e_in_count;
+		view.e_out_count = h.e_out_count;
+		view.max_deg_in = h.max_deg_in;
+		view.max_deg_out = h.max_deg_out;
+		view.max_degree = h.max_degree;
+		view.n_attr_count = h.n_attr_count;
+		view.e_attr_count = h.e_attr_count;
+		view.attr = (Node*)(base + h.attr_offset);
+		view.in_offset = (uint32_t*)(base + h.in_offset_offset);
+		view.out_offset = (uint32_t*)(base + h.out_offset_offset);
+		view.in_nodes = (nodeID_t*)(base + h.in_nodes_offset);
+		view.out_nodes = (nodeID_t*)(base + h.out_nodes_offset);
+		view.in_attr = (Edge*)(base + h.in_attr_offset);
+		view.out_attr = (Edge*)(base + h.out_attr_offset);
+		return view;
+	}
+
+}
+
+#endif /* ARGRAPHSNAPSHOT_HPP */
@@ -0,0 +1,329 @@
+/**
+ * @file   CandidateDomains.hpp
+ * @brief  Candidate target nodes of each pattern node.
+ * @details Computed once, after the classification, and shared by all the
+ * states of a search. A target node is a candidate of a pattern node when
+ * it has the same class, no less in and out edges, and, for each class, no
+ * less in and out neighbors of that class (neighbor label filter).
+ * Nodes failing these filters can't be matched in any solution, both for
+ * the node-induced and the edge-induced problem.
+ */
+
+#ifndef CANDIDATEDOMAINS_HPP
+#define CANDIDATEDOMAINS_HPP
+
+#include <vector>
+#include <thread>
+#include <utility>
+#include <algorithm>
+
+#include <ARGraph.hpp>
+
+namespace vflib
+{
+	const uint32_t DOMAINS_PARALLEL_MIN_NODES = 1 << 16;		/**<Min number of target nodes to filter them on several threads */
+	const size_t DOMAINS_BITSET_BUDGET = (size_t)64 << 20;	/**<Default max size in bytes of the membership bitsets */
+
+	/*
+	* @class NeighborClassFilter
+	* @brief Degrees and neighbor classes of the pattern nodes, grouped by class
+	* @details A target node passes the filter of a pattern node of its class
+	* if it has no less in and out neighbors, both overall and of each class.
+	* The neighbors of the target node are counted by the caller, so that
+	* it can leave out the ones already known not to be viable.
+	*/
+	class NeighborClassFilter
+	{
+	private:
+		typedef std::pair<uint32_t, uint32_t> ClassCount;	//< Class and number of neighbors of that class
+
+		std::vector<uint32_t> class_first;	//< First pattern node of each class in by_class
+		std::vector<nodeID_t> by_class;		//< Pattern nodes, grouped by class
+		std::vector<uint32_t> out_deg, in_deg;
+		std::vector<size_t> out_first, in_first;
+		std::vector<ClassCount> out_counts, in_counts;
+
+		template<typename Node, typename Edge>
+		static void CountNeighborClasses(ARGraph<Node, Edge>* g, nodeID_t n, bool out,
+			const std::vector<uint32_t>& classes, std::vector<ClassCount>& counts)
+		{
+			uint32_t count = out ? g->OutEdgeCount(n) : g->InEdgeCount(n);
+			size_t first = counts.size();
+			for (uint32_t i = 0; i < count; i++)
+			{
+				uint32_t c = classes[out ? g->GetOutEdge(n, i) : g->GetInEdge(n, i)];
+				size_t j = first;
+				while (j < counts.size() && counts[j].first != c)
+					j++;
+				if (j < counts.size())
+					counts[j].second++;
+				else
+					counts.push_back(ClassCount(c, 1));
+			}
+		}
+
+		static bool Covers(const ClassCount* first, const ClassCount* last, const uint32_t* counts)
+		{
+			for (; first < last; first++)
+				if (first->second > counts[first->first])
+					return false;
+			return true;
+		}
+
+	public:
+		/*
+		* @fn NeighborClassFilter
+		* @param [in] g1 Pattern
+		* @param [in] class_1 Classes of the pattern nodes
+		* @param [in] classes_count Number of classes
+		*/
+		template<typename Node, typename Edge>
+		NeighborClassFilter(ARGraph<Node, Edge>* g1, const std::vector<uint32_t>& class_1,
+			uint32_t classes_count)
+		{
+			uint32_t count = g1->NodeCount();
+			nodeID_t u;
+
+			class_first.assign(classes_count + 1, 0);
+			by_class.resize(count);
+			out_deg.resize(count);
+			in_deg.resize(count);
+			out_first.resize(count + 1);
+			in_first.resize(count + 1);
+			for (u = 0; u < count; u++)
+			{
+				class_first[class_1[u] + 1]++;
+				out_deg[u] = g1->OutEdgeCount(u);
+				in_deg[u] = g1->InEdgeCount(u);
+				out_first[u] = out_counts.size();
+				in_first[u] = in_counts.size();
+				CountNeighborClasses(g1, u, true, class_1, out_counts);
+				CountNeighborClasses(g1, u, false, class_1, in_counts);
+			}
+			out_first[count] = out_counts.size();
+			in_first[count] = in_counts.size();
+			for (uint32_t c = 0; c < classes_count; c++)
+				class_first[c + 1] += class_first[c];
+
+			std::vector<uint32_t> next(class_first.begin(), class_first.end() - 1);
+			for (u = 0; u < count; u++)
+				by_class[next[class_1[u]]++] = u;
+		}
+
+		/*
+		* @fn ClassBegin
+		* @brief Index of the first pattern node of a class, see PatternNode
+		*/
+		inline uint32_t ClassBegin(uint32_t c) const { return class_first[c]; }
+
+		/*
+		* @fn ClassEnd
+		* @brief Index after the last pattern node of a class
+		*/
+		inline uint32_t ClassEnd(uint32_t c) const { return class_first[c + 1]; }
+
+		/*
+		* @fn PatternNode
+		* @brief k-th pattern node, by class
+		*/
+		inline nodeID_t PatternNode(uint32_t k) const { return by_class[k]; }
+
+		/*
+		* @fn AdmitsDegree
+		* @brief Checks only the overall in and out degree of a target node
+		*/
+		inline bool AdmitsDegree(nodeID_t u, uint32_t out, uint32_t in) const
+		{
+			return out_deg[u] <= out && in_deg[u] <= in;
+		}
+
+		/*
+		* @fn AdmitsNeighbors
+		* @brief Checks the out and in neighbors of a target node, counted by class
+		*/
+		inline bool AdmitsNeighbors(nodeID_t u, const uint32_t* out_c, const uint32_t* in_c) const
+		{
+			return Covers(out_counts.data() + out_first[u], out_counts.data() + out_first[u + 1], out_c)
+				&& Covers(in_counts.data() + in_first[u], in_counts.data() + in_first[u + 1], in_c);
+		}
+	};
+
+	/*
+	* @class CandidateDomains
+	* @brief Sorted list of the candidates of each pattern node
+	* @details When it fits the budget, a bitset per pattern node gives the
+	* membership of a target node in constant time; otherwise the sorted
+	* list is searched.
+	*/
+	class CandidateDomains
+	{
+	private:
+		uint32_t pattern_count;
+		std::vector<size_t> offset;		//< First candidate of each pattern node
+		std::vector<nodeID_t> ids;		//< Candidates of each pattern node, by increasing id
+		std::vector<uint64_t> bits;		//< Bitset of the candidates of each pattern node, empty if over the budget
+		size_t words;					//< Words of the bitset of a pattern node
+		bool empty_domain;				//< Some pattern node has no candidates
+
+		CandidateDomains(const CandidateDomains&);
+		CandidateDomains& operator=(const CandidateDomains&);
+
+	public:
+		/*
+		* @fn CandidateDomains
+		* @brief Filters the target nodes for each pattern node
+		* @param [in] g1 Pattern
+		* @param [in] g2 Target
+		* @param [in] class_1 Classes of the pattern nodes
+		* @param [in] class_2 Classes of the target nodes
+		* @param [in] classes_count Number of classes
+		* @param [in] bitset_budget Max size in bytes of the bitsets, 0 to disable them
+		* @param [in] threads Number of threads, 0 to use all the available cores
+		*/
+		template<typename Node1, typename Node2, typename Edge1, typename Edge2>
+		CandidateDomains(ARGraph<Node1, Edge1>* g1, ARGraph<Node2, Edge2>* g2,
+			const std::vector<uint32_t>& class_1, const std::vector<uint32_t>& class_2,
+			uint32_t classes_count, size_t bitset_budget = DOMAINS_BITSET_BUDGET,
+			uint32_t threads = 0)
+		{
+			pattern_count = g1->NodeCount();
+			uint32_t target_count = g2->NodeCount();
+			NeighborClassFilter filter(g1, class_1, classes_count);
+			nodeID_t u;
+
+			if (!threads)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			if (target_count < DOMAINS_PARALLEL_MIN_NODES)
+				threads = 1;
+
+			//Each chunk of target nodes lists its (pattern, target) pairs,
+			//by increasing target node
+			std::vector<std::vector<std::pair<nodeID_t, nodeID_t> > > found(threads);
+			auto scan = [&](uint32_t t) {
+				nodeID_t first = (nodeID_t)((uint64_t)target_count * t / threads);
+				nodeID_t last = (nodeID_t)((uint64_t)target_count * (t + 1) / threads);
+				std::vector<uint32_t> out_c(classes_count, 0), in_c(classes_count, 0);
+				std::vector<uint32_t> touched;
+				for (nodeID_t v = first; v < last; v++)
+				{
+					uint32_t c = class_2[v];
+					uint32_t out_deg = g2->OutEdgeCount(v);
+					uint32_t in_deg = g2->InEdgeCount(v);
+					bool counted = false;
+					for (uint32_t k = filter.ClassBegin(c); k < filter.ClassEnd(c); k++)
+					{
+						nodeID_t n = filter.PatternNode(k);
+						if (!filter.AdmitsDegree(n, out_deg, in_deg))
+							continue;
+
+						if (!counted)
+						{
+							for (uint32_t i = 0; i < out_deg; i++)
+							{
+								uint32_t nc = class_2[g2->GetOutEdge(v, i)];
+								if (!out_c[nc] && !in_c[nc])
+									touched.push_back(nc);
+								out_c[nc]++;
+							}
+							for (uint32_t i = 0; i < in_deg; i++)
+							{
+								uint32_t nc = class_2[g2->GetInEdge(v, i)];
+								if (!out_c[nc] && !in_c[nc])
+									touched.push_back(nc);
+								in_c[nc]++;
+							}
+							counted = true;
+						}
+
+						if (filter.AdmitsNeighbors(n, out_c.data(), in_c.data()))
+							found[t].push_back(std::make_pair(n, v));
+					}
+
+					for (size_t i = 0; i < touched.size(); i++)
+						out_c[touched[i]] = in_c[touched[i]] = 0;
+					touched.clear();
+				}
+			};
+
+			std::vector<std::thread> pool;
+			for (uint32_t t = 1; t < threads; t++)
+				pool.push_back(std::thread(scan, t));
+			scan(0);
+			for (size_t t = 0; t < pool.size(); t++)
+				pool[t].join();
+
+			//Counting sort by pattern node, stable on the target nodes
+			offset.assign(pattern_count + 1, 0);
+			for (uint32_t t = 0; t < threads; t++)
+				for (size_t i = 0; i < found[t].size(); i++)
+					offset[found[t][i].first + 1]++;
+			for (u = 0; u < pattern_count; u++)
+				offset[u + 1] += offset[u];
+			ids.resize(offset[pattern_count]);
+			{
+				std::vector<size_t> next(offset.begin(), offset.end() - 1);
+				for (uint32_t t = 0; t < threads; t++)
+				{
+					for (size_t i = 0; i < found[t].size(); i++)
+						ids[next[found[t][i].first]++] = found[t][i].second;
+					std::vector<std::pair<nodeID_t, nodeID_t> >().swap(found[t]);
+				}
+			}
+
+			empty_domain = false;
+			for (u = 0; u < pattern_count; u++)
+				if (offset[u] == offset[u + 1])
+					empty_domain = true;
+
+			words = ((size_t)target_count + 63) / 64;
+			if ((uint64_t)pattern_count * words * sizeof(uint64_t) <= bitset_budget)
+			{
+				bits.assign((size_t)pattern_count * words, 0);
+				for (u = 0; u < pattern_count; u++)
+					for (size_t i = offset[u]; i < offset[u + 1]; i++)
+						bits[u * words + (ids[i] >> 6)] |= (uint64_t)1 << (ids[i] & 63);
+			}
+		}
+
+		/*
+		* @fn Size
+		* @brief Number of candidates of a pattern node
+		*/
+		inline uint32_t Size(nodeID_t n1) const
+		{
+			return (uint32_t)(offset[n1 + 1] - offset[n1]);
+		}
+
+		/*
+		* @fn Candidates
+		* @brief Candidates of a pattern node, by increasing id
+		*/
+		inline const nodeID_t* Candidates(nodeID_t n1) const
+		{
+			return ids.data() + offset[n1];
+		}
+
+		/*
+		* @fn Contains
+		* @brief Checks if a target node is a candidate of a pattern node
+		*/
+		inline bool Contains(nodeID_t n1, nodeID_t n2) const
+		{
+			if (!bits.empty())
+				return (bits[n1 * words + (n2 >> 6)] >> (n2 & 63)) & 1;
+			return std::binary_search(ids.begin() + offset[n1], ids.begin() + offset[n1 + 1], n2);
+		}
+
+		/*
+		* @fn HasEmptyDomain
+		* @brief TRUE if some pattern node has no candidates, so that there are no solutions
+		*/
+		inline bool HasEmptyDomain() const
+		{
+			return empty_domain;
+		}
+	};
+
+}
+
+#endif /* CANDIDATEDOMAINS_HPP */
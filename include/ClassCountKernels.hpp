@@ -0,0 +1,193 @@
+/**
+ * @file   ClassCountKernels.hpp
+ * @brief  Class-wise comparison of the terminal set counts for the look-ahead.
+ * @details The look-ahead of VF3 fails when, for some class, the pattern
+ * has more neighbors in a terminal set than the target. The three count
+ * vectors are compared in a single pass, several classes at a time with
+ * SSE4.1, AVX2 or AVX-512, chosen at run time, stopping at the first block
+ * with a violation. A class with no pattern counts can't fail, so when
+ * few classes have them the listed ones are checked one by one instead.
+ */
+
+#ifndef CLASSCOUNTKERNELS_HPP
+#define CLASSCOUNTKERNELS_HPP
+
+#include <stdint.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CLASS_COUNT_X86
+#include <immintrin.h>
+#endif
+
+namespace vflib
+{
+	namespace classcounts
+	{
+		const uint32_t VECTOR_MIN_CLASSES = 8;	/**<Below this number of classes the scalar loop is used */
+		const uint32_t LISTED_MAX_FRACTION = 4;	/**<Listed classes are checked one by one when at most 1/4 of all of them */
+
+		/*
+		* Checks if the pattern counts exceed the target ones for some class.
+		* The in and out counts are compared one by one; the new ones too, or,
+		* with sum_new, the sum of the three counts, as for the edge-induced problem.
+		*/
+		typedef bool(*ExceedsKernel)(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count, bool sum_new);
+
+		inline bool Exceeds(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count, bool sum_new)
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				if (in1[i] > in2[i] || out1[i] > out2[i])
+					return true;
+				if (sum_new ? in1[i] + out1[i] + new1[i] > in2[i] + out2[i] + new2[i] : new1[i] > new2[i])
+					return true;
+			}
+			return false;
+		}
+
+		//As Exceeds, checking only the listed classes
+		inline bool ExceedsListed(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2,
+			const uint32_t* listed, uint32_t listed_count, bool sum_new)
+		{
+			for (uint32_t k = 0; k < listed_count; k++)
+			{
+				uint32_t c = listed[k];
+				if (in1[c] > in2[c] || out1[c] > out2[c])
+					return true;
+				if (sum_new ? in1[c] + out1[c] + new1[c] > in2[c] + out2[c] + new2[c] : new1[c] > new2[c])
+					return true;
+			}
+			return false;
+		}
+
+#ifdef CLASS_COUNT_X86
+		//a <= b on unsigned lanes is max(a, b) == b
+		__attribute__((target("sse4.1")))
+		inline bool ExceedsSse41(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count, bool sum_new)
+		{
+			uint32_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i a_in = _mm_loadu_si128((const __m128i*)(in1 + i));
+				__m128i a_out = _mm_loadu_si128((const __m128i*)(out1 + i));
+				__m128i a_new = _mm_loadu_si128((const __m128i*)(new1 + i));
+				__m128i b_in = _mm_loadu_si128((const __m128i*)(in2 + i));
+				__m128i b_out = _mm_loadu_si128((const __m128i*)(out2 + i));
+				__m128i b_new = _mm_loadu_si128((const __m128i*)(new2 + i));
+				if (sum_new)
+				{
+					a_new = _mm_add_epi32(_mm_add_epi32(a_in, a_out), a_new);
+					b_new = _mm_add_epi32(_mm_add_epi32(b_in, b_out), b_new);
+				}
+				__m128i ok = _mm_and_si128(_mm_cmpeq_epi32(_mm_max_epu32(a_in, b_in), b_in),
+					_mm_cmpeq_epi32(_mm_max_epu32(a_out, b_out), b_out));
+				ok = _mm_and_si128(ok, _mm_cmpeq_epi32(_mm_max_epu32(a_new, b_new), b_new));
+				if (_mm_movemask_epi8(ok) != 0xFFFF)
+					return true;
+			}
+			return Exceeds(in1 + i, out1 + i, new1 + i, in2 + i, out2 + i, new2 + i, count - i, sum_new);
+		}
+
+		__attribute__((target("avx2")))
+		inline bool ExceedsAvx2(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count, bool sum_new)
+		{
+			uint32_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256i a_in = _mm256_loadu_si256((const __m256i*)(in1 + i));
+				__m256i a_out = _mm256_loadu_si256((const __m256i*)(out1 + i));
+				__m256i a_new = _mm256_loadu_si256((const __m256i*)(new1 + i));
+				__m256i b_in = _mm256_loadu_si256((const __m256i*)(in2 + i));
+				__m256i b_out = _mm256_loadu_si256((const __m256i*)(out2 + i));
+				__m256i b_new = _mm256_loadu_si256((const __m256i*)(new2 + i));
+				if (sum_new)
+				{
+					a_new = _mm256_add_epi32(_mm256_add_epi32(a_in, a_out), a_new);
+					b_new = _mm256_add_epi32(_mm256_add_epi32(b_in, b_out), b_new);
+				}
+				__m256i ok = _mm256_and_si256(_mm256_cmpeq_epi32(_mm256_max_epu32(a_in, b_in), b_in),
+					_mm256_cmpeq_epi32(_mm256_max_epu32(a_out, b_out), b_out));
+				ok = _mm256_and_si256(ok, _mm256_cmpeq_epi32(_mm256_max_epu32(a_new, b_new), b_new));
+				if (_mm256_movemask_epi8(ok) != -1)
+					return true;
+			}
+			return ExceedsSse41(in1 + i, out1 + i, new1 + i, in2 + i, out2 + i, new2 + i, count - i, sum_new);
+		}
+
+		__attribute__((target("avx512f")))
+		inline bool ExceedsAvx512(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count, bool sum_new)
+		{
+			uint32_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m512i a_in = _mm512_loadu_si512((const void*)(in1 + i));
+				__m512i a_out = _mm512_loadu_si512((const void*)(out1 + i));
+				__m512i a_new = _mm512_loadu_si512((const void*)(new1 + i));
+				__m512i b_in = _mm512_loadu_si512((const void*)(in2 + i));
+				__m512i b_out = _mm512_loadu_si512((const void*)(out2 + i));
+				__m512i b_new = _mm512_loadu_si512((const void*)(new2 + i));
+				if (sum_new)
+				{
+					a_new = _mm512_add_epi32(_mm512_add_epi32(a_in, a_out), a_new);
+					b_new = _mm512_add_epi32(_mm512_add_epi32(b_in, b_out), b_new);
+				}
+				if (_mm512_cmpgt_epu32_mask(a_in, b_in) | _mm512_cmpgt_epu32_mask(a_out, b_out)
+					| _mm512_cmpgt_epu32_mask(a_new, b_new))
+					return true;
+			}
+			return ExceedsAvx2(in1 + i, out1 + i, new1 + i, in2 + i, out2 + i, new2 + i, count - i, sum_new);
+		}
+#endif
+
+		inline ExceedsKernel SelectExceeds()
+		{
+#ifdef CLASS_COUNT_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+				return ExceedsAvx512;
+			if (__builtin_cpu_supports("avx2"))
+				return ExceedsAvx2;
+			if (__builtin_cpu_supports("sse4.1"))
+				return ExceedsSse41;
+#endif
+			return Exceeds;
+		}
+
+		/*
+		* @fn AnyExceeds
+		* @brief Exceeds with the fastest kernel for the CPU and the number of classes
+		*/
+		inline bool AnyExceeds(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count, bool sum_new)
+		{
+			static const ExceedsKernel kernel = SelectExceeds();
+			if (count < VECTOR_MIN_CLASSES)
+				return Exceeds(in1, out1, new1, in2, out2, new2, count, sum_new);
+			return kernel(in1, out1, new1, in2, out2, new2, count, sum_new);
+		}
+
+		/*
+		* @fn AnyExceeds
+		* @brief As above, knowing the classes with some pattern count
+		* @param [in] listed The classes where the pattern counts are not all zero
+		* @param [in] listed_count Number of listed classes
+		*/
+		inline bool AnyExceeds(const uint32_t* in1, const uint32_t* out1, const uint32_t* new1,
+			const uint32_t* in2, const uint32_t* out2, const uint32_t* new2, uint32_t count,
+			const uint32_t* listed, uint32_t listed_count, bool sum_new)
+		{
+			if (listed_count * LISTED_MAX_FRACTION <= count)
+				return ExceedsListed(in1, out1, new1, in2, out2, new2, listed, listed_count, sum_new);
+			return AnyExceeds(in1, out1, new1, in2, out2, new2, count, sum_new);
+		}
+	}
+
+}
+
+#endif /* CLASSCOUNTKERNELS_HPP */
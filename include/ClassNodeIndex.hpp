@@ -0,0 +1,70 @@
+/**
+ * @file   ClassNodeIndex.hpp
+ * @brief  Nodes of a graph grouped by class.
+ * @details Used by the states to find the candidates of a pattern node
+ * without a predecessor (the first one, and the first one of each other
+ * connected component) by scanning only the target nodes of its class.
+ */
+
+#ifndef CLASSNODEINDEX_HPP
+#define CLASSNODEINDEX_HPP
+
+#include <vector>
+
+#include <ARGraph.hpp>
+
+namespace vflib
+{
+	/*
+	* @class ClassNodeIndex
+	* @brief Sorted list of the nodes of each class
+	*/
+	class ClassNodeIndex
+	{
+	private:
+		std::vector<uint32_t> offset;	//< First node of each class
+		std::vector<nodeID_t> nodes;	//< Nodes, grouped by class and by increasing id
+
+	public:
+		/*
+		* @fn ClassNodeIndex
+		* @param [in] classes Class of each node
+		* @param [in] count Number of nodes
+		* @param [in] classes_count Number of classes
+		*/
+		ClassNodeIndex(const uint32_t* classes, uint32_t count, uint32_t classes_count)
+		{
+			offset.assign(classes_count + 1, 0);
+			nodes.resize(count);
+			for (nodeID_t n = 0; n < count; n++)
+				offset[classes[n] + 1]++;
+			for (uint32_t c = 0; c < classes_count; c++)
+				offset[c + 1] += offset[c];
+
+			std::vector<uint32_t> next(offset.begin(), offset.end() - 1);
+			for (nodeID_t n = 0; n < count; n++)
+				nodes[next[classes[n]]++] = n;
+		}
+
+		/*
+		* @fn Size
+		* @brief Number of nodes of a class, 0 for a class past the indexed ones
+		*/
+		inline uint32_t Size(uint32_t c) const
+		{
+			return c < offset.size() - 1 ? offset[c + 1] - offset[c] : 0;
+		}
+
+		/*
+		* @fn Nodes
+		* @brief Nodes of a class, by increasing id
+		*/
+		inline const nodeID_t* Nodes(uint32_t c) const
+		{
+			return nodes.data() + (c < offset.size() - 1 ? offset[c] : nodes.size());
+		}
+	};
+
+}
+
+#endif /* CLASSNODEINDEX_HPP */
@@ -0,0 +1,255 @@
+/**
+ * @file   HashNodeClassifier.hpp
+ * @brief  Node classifier based on a flat hash table.
+ * @details Classes are the distinct node attributes, numbered in the
+ * order they are first met, as in NodeClassifier. Attributes are looked
+ * up in an open addressing table instead of a std::map, and on large
+ * graphs the nodes are classified in parallel chunks.
+ * Attributes need a hash functor (std::hash by default) and operator<.
+ */
+
+#ifndef HASHNODECLASSIFIER_HPP
+#define HASHNODECLASSIFIER_HPP
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include <ARGraph.hpp>
+
+namespace vflib
+{
+	const uint32_t CLASSIFIER_PARALLEL_MIN_NODES = 1 << 16;	/**<Min number of nodes to classify a graph on several threads */
+
+	/*
+	* @class ClassTable
+	* @brief Flat hash table assigning consecutive ids to attributes.
+	* @details Linear probing on a power of two table, kept at most half full.
+	* Two attributes are equal when neither is less than the other.
+	*/
+	template<typename Node, typename Hash = std::hash<Node> >
+	class ClassTable
+	{
+	private:
+		std::vector<Node> values;		//< Attribute of each id
+		std::vector<uint32_t> slots;	//< Id + 1 of the attribute in each slot, 0 if the slot is empty
+		Hash hash;
+
+		static bool Same(const Node &a, const Node &b)
+		{
+			return !(a < b) && !(b < a);
+		}
+
+		size_t FindSlot(const Node &attr) const
+		{
+			size_t mask = slots.size() - 1;
+			size_t s = hash(attr) & mask;
+			while (slots[s] && !Same(values[slots[s] - 1], attr))
+				s = (s + 1) & mask;
+			return s;
+		}
+
+		void Grow()
+		{
+			std::vector<uint32_t> old(std::max<size_t>(16, slots.size() * 2), 0);
+			slots.swap(old);
+			for (uint32_t id = 0; id < values.size(); id++)
+				slots[FindSlot(values[id])] = id + 1;
+		}
+
+	public:
+		ClassTable() { Grow(); }
+
+		/*
+		* @fn Count
+		* @brief Number of attributes in the table
+		*/
+		uint32_t Count() const { return (uint32_t)values.size(); }
+
+		/*
+		* @fn Value
+		* @brief Attribute of an id
+		*/
+		const Node& Value(uint32_t id) const { return values[id]; }
+
+		/*
+		* @fn Find
+		* @brief Looks for an attribute without adding it
+		* @returns FALSE if the attribute is not in the table
+		*/
+		bool Find(const Node &attr, uint32_t &id) const
+		{
+			uint32_t slot = slots[FindSlot(attr)];
+			if (!slot)
+				return false;
+			id = slot - 1;
+			return true;
+		}
+
+		/*
+		* @fn Insert
+		* @brief Gets the id of an attribute, adding it if it is new
+		*/
+		uint32_t Insert(const Node &attr)
+		{
+			size_t s = FindSlot(attr);
+			if (slots[s])
+				return slots[s] - 1;
+			if (2 * (values.size() + 1) > slots.size())
+			{
+				Grow();
+				s = FindSlot(attr);
+			}
+			values.push_back(attr);
+			slots[s] = (uint32_t)values.size();
+			return slots[s] - 1;
+		}
+	};
+
+	/*
+	* @class HashNodeClassifier
+	* @brief Node classifier with the same classes of NodeClassifier
+	* @details The target is classified first. The classifier of the pattern
+	* only reads the table of the target: attributes missing in the target
+	* get new classes, numbered after the ones of the target, so that they
+	* can't be confused with any target class.
+	*/
+	template<typename Node, typename Edge, typename Hash = std::hash<Node> >
+	class HashNodeClassifier
+	{
+	private:
+		ClassTable<Node, Hash> table;		//< Attributes first met in this graph
+		const HashNodeClassifier* base;		//< Classifier of the target, for a pattern
+		std::vector<uint32_t> classes;		//< Class of each node
+
+		HashNodeClassifier(const HashNodeClassifier&);
+		HashNodeClassifier& operator=(const HashNodeClassifier&);
+
+		uint32_t BaseCount() const
+		{
+			return base ? base->CountClasses() : 0;
+		}
+
+		/*
+		* @fn ClassOf
+		* @brief Class of an attribute already met
+		*/
+		uint32_t ClassOf(const Node &attr) const
+		{
+			uint32_t c = 0;
+			if (base && base->table.Find(attr, c))
+				return c;
+			table.Find(attr, c);
+			return BaseCount() + c;
+		}
+
+		template <typename Function>
+		static void RunParallel(uint32_t tasks, Function f)
+		{
+			std::vector<std::thread> pool;
+			for (uint32_t t = 1; t < tasks; t++)
+				pool.push_back(std::thread(f, t));
+			f(0);
+			for (size_t t = 0; t < pool.size(); t++)
+				pool[t].join();
+		}
+
+		void GenerateClasses(ARGraph<Node, Edge>* g, uint32_t threads)
+		{
+			uint32_t count = g->NodeCount();
+			uint32_t c;
+			nodeID_t n;
+
+			if (!threads)
+				threads = std::max(1u, std::thread::hardware_concurrency());
+			if (count < CLASSIFIER_PARALLEL_MIN_NODES)
+				threads = 1;
+
+			classes.resize(count);
+			if (threads == 1)
+			{
+				for (n = 0; n < count; n++)
+				{
+					const Node &attr = g->GetNodeAttr(n);
+					if (base && base->table.Find(attr, c))
+						classes[n] = c;
+					else
+						classes[n] = BaseCount() + table.Insert(attr);
+				}
+				return;
+			}
+
+			//Each chunk collects its attributes in order of appearance, then
+			//the chunks are merged in order, so that the ids are the same of
+			//a sequential scan
+			std::vector<ClassTable<Node, Hash> > chunk_tables(threads);
+			RunParallel(threads, [&](uint32_t t) {
+				nodeID_t first = (nodeID_t)((uint64_t)count * t / threads);
+				nodeID_t last = (nodeID_t)((uint64_t)count * (t + 1) / threads);
+				uint32_t id;
+				for (nodeID_t i = first; i < last; i++)
+				{
+					const Node &attr = g->GetNodeAttr(i);
+					if (!base || !base->table.Find(attr, id))
+						chunk_tables[t].Insert(attr);
+				}
+			});
+			for (uint32_t t = 0; t < threads; t++)
+				for (c = 0; c < chunk_tables[t].Count(); c++)
+					table.Insert(chunk_tables[t].Value(c));
+			std::vector<ClassTable<Node, Hash> >().swap(chunk_tables);
+
+			RunParallel(threads, [&](uint32_t t) {
+				nodeID_t first = (nodeID_t)((uint64_t)count * t / threads);
+				nodeID_t last = (nodeID_t)((uint64_t)count * (t + 1) / threads);
+				for (nodeID_t i = first; i < last; i++)
+					classes[i] = ClassOf(g->GetNodeAttr(i));
+			});
+		}
+
+	public:
+		/*
+		* @fn HashNodeClassifier
+		* @brief Classifies the nodes of the target
+		* @param [in] g Graph
+		* @param [in] threads Number of threads, 0 to use all the available cores
+		*/
+		HashNodeClassifier(ARGraph<Node, Edge>* g, uint32_t threads = 0): base(NULL)
+		{
+			GenerateClasses(g, threads);
+		}
+
+		/*
+		* @fn HashNodeClassifier
+		* @brief Classifies the nodes of the pattern with the classes of the target
+		* @note The classifier of the target must outlive this one
+		*/
+		HashNodeClassifier(ARGraph<Node, Edge>* g, const HashNodeClassifier& classifier,
+			uint32_t threads = 0): base(&classifier)
+		{
+			GenerateClasses(g, threads);
+		}
+
+		/*
+		* @fn CountClasses
+		* @brief Returns the number of classes, including the ones of the target
+		*/
+		uint32_t CountClasses() const
+		{
+			return BaseCount() + table.Count();
+		}
+
+		/*
+		* @fn GetClasses
+		* @brief Returns the class of each node
+		*/
+		const std::vector<uint32_t>& GetClasses() const
+		{
+			return classes;
+		}
+	};
+
+}
+
+#endif /* HASHNODECLASSIFIER_HPP */
@@ -0,0 +1,88 @@
+/**
+ * @file   LabelDictionary.hpp
+ * @brief  Dictionary mapping node labels to dense integer ids.
+ * @details Graphs with labels of an expensive type (e.g. strings) can be
+ * loaded through an InterningARGLoader, so that matching, classification
+ * and probabilities work on integer ids. The dictionary keeps the
+ * original labels, to be used for the output.
+ */
+
+#ifndef LABELDICTIONARY_HPP
+#define LABELDICTIONARY_HPP
+
+#include <assert.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace vflib
+{
+	/**
+	* @class LabelDictionary
+	* @brief Assigns consecutive ids, starting from 0, to the labels in
+	* the order they are first seen.
+	* @note The same dictionary must be used for all the graphs to be
+	* matched, so that equal labels get equal ids.
+	* Only operator< is required on the labels.
+	*/
+	template<typename Label>
+	class LabelDictionary
+	{
+	private:
+		std::map<Label, uint32_t> ids;
+		std::vector<Label> labels;
+
+	public:
+		/**
+		* @brief Gets the id of a label, adding the label if it is new.
+		* @param [in] label Label.
+		* @returns Id of the label.
+		*/
+		uint32_t Intern(const Label &label)
+		{
+			typename std::map<Label, uint32_t>::iterator it = ids.lower_bound(label);
+			if (it != ids.end() && !(label < it->first))
+				return it->second;
+
+			uint32_t id = (uint32_t)labels.size();
+			ids.insert(it, std::make_pair(label, id));
+			labels.push_back(label);
+			return id;
+		}
+
+		/**
+		* @brief Looks for a label without adding it.
+		* @param [in] label Label.
+		* @param [out] id Id of the label.
+		* @retval TRUE If the label is in the dictionary.
+		* @retval FALSE If the label is not in the dictionary.
+		*/
+		bool Find(const Label &label, uint32_t &id) const
+		{
+			typename std::map<Label, uint32_t>::const_iterator it = ids.find(label);
+			if (it == ids.end())
+				return false;
+			id = it->second;
+			return true;
+		}
+
+		/**
+		* @brief Gets the original label of an id.
+		* @param [in] id Id of the label.
+		* @returns The label.
+		*/
+		const Label& GetLabel(uint32_t id) const
+		{
+			assert(id < labels.size());
+			return labels[id];
+		}
+
+		/**
+		* @brief Number of distinct labels in the dictionary.
+		* @returns Number of labels.
+		*/
+		uint32_t Count() const { return (uint32_t)labels.size(); }
+	};
+}
+
+#endif /* LABELDICTIONARY_HPP */
@@ -0,0 +1,163 @@
+/**
+ * @file   LevelClassTables.hpp
+ * @brief  Sizes of the terminal sets of the pattern at each level of the search.
+ * @details The VF3 states precompute, for each level of the matching order,
+ * the sizes of the terminal sets of the pattern, overall and by class.
+ * All of them are kept in a single cache line aligned block, laid out by
+ * level: the look-ahead of a level reads a few adjacent cache lines.
+ */
+
+#ifndef LEVELCLASSTABLES_HPP
+#define LEVELCLASSTABLES_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+#include <Error.hpp>
+
+namespace vflib
+{
+	const size_t LEVEL_TABLES_ALIGNMENT = 64;	/**<Alignment in bytes of each level, the size of a cache line */
+
+	/*
+	* @class LevelClassTables
+	* @brief Terminal set sizes of the pattern, by level and by class
+	* @details Each level holds the totals of the tables, then a row per
+	* table with the count of each class. Every table starts from zero.
+	* The classes with a count in TERM_IN, TERM_OUT or NEW can also be
+	* listed for each level, the only ones the look-ahead has to check.
+	*/
+	class LevelClassTables
+	{
+	public:
+		enum Table
+		{
+			T1_BOTH,	//< Nodes both in the in and out terminal sets
+			T1_IN,		//< Nodes in the in terminal set
+			T1_OUT,		//< Nodes in the out terminal set
+			TERM_IN,	//< Unmapped neighbors of the added node in the in terminal set
+			TERM_OUT,	//< Unmapped neighbors of the added node in the out terminal set
+			NEW,		//< Unmapped neighbors of the added node outside the terminal sets
+			TABLES_COUNT
+		};
+
+	private:
+		uint32_t levels;
+		uint32_t classes_count;
+		size_t stride;		//< Values of a level, rounded to a cache line
+		uint32_t *data;
+		std::vector<uint32_t> active_first;	//< First listed class of each level
+		std::vector<uint32_t> active;		//< Classes with a count in the look-ahead tables, by level
+
+		LevelClassTables(const LevelClassTables&);
+		LevelClassTables& operator=(const LevelClassTables&);
+
+	public:
+		/*
+		* @fn LevelClassTables
+		* @param [in] levels Number of levels
+		* @param [in] classes_count Number of classes
+		*/
+		LevelClassTables(uint32_t levels, uint32_t classes_count):levels(levels), classes_count(classes_count)
+		{
+			const size_t line = LEVEL_TABLES_ALIGNMENT / sizeof(uint32_t);
+			stride = ((size_t)TABLES_COUNT * (classes_count + 1) + line - 1) / line * line;
+			size_t bytes = (levels ? levels : 1) * stride * sizeof(uint32_t);
+#ifdef WIN32
+			data = (uint32_t*)_aligned_malloc(bytes, LEVEL_TABLES_ALIGNMENT);
+#else
+			if (posix_memalign((void**)&data, LEVEL_TABLES_ALIGNMENT, bytes))
+				data = NULL;
+#endif
+			if (!data)
+				error("Out of memory for the terminal set sizes");
+			memset(data, 0, bytes);
+		}
+
+		~LevelClassTables()
+		{
+#ifdef WIN32
+			_aligned_free(data);
+#else
+			free(data);
+#endif
+		}
+
+		/*
+		* @fn Total
+		* @brief Value of a table at a level, over all the classes
+		*/
+		inline uint32_t& Total(uint32_t level, Table t)
+		{
+			return data[level * stride + t];
+		}
+
+		inline uint32_t Total(uint32_t level, Table t) const
+		{
+			return data[level * stride + t];
+		}
+
+		/*
+		* @fn Classes
+		* @brief Row of a table at a level, with a value per class
+		* @note The rows of a level follow each other in the order of Table
+		*/
+		inline uint32_t* Classes(uint32_t level, Table t)
+		{
+			return data + level * stride + TABLES_COUNT + t * classes_count;
+		}
+
+		inline const uint32_t* Classes(uint32_t level, Table t) const
+		{
+			return data + level * stride + TABLES_COUNT + t * classes_count;
+		}
+
+		/*
+		* @fn BuildActiveClasses
+		* @brief Lists the classes with a count in TERM_IN, TERM_OUT or NEW at each level
+		* @note The list is not updated by later changes to the tables
+		*/
+		void BuildActiveClasses()
+		{
+			active_first.resize(levels + 1);
+			active.clear();
+			for (uint32_t level = 0; level < levels; level++)
+			{
+				active_first[level] = (uint32_t)active.size();
+				const uint32_t *term_in = Classes(level, TERM_IN);
+				const uint32_t *term_out = Classes(level, TERM_OUT);
+				const uint32_t *fresh = Classes(level, NEW);
+				for (uint32_t c = 0; c < classes_count; c++)
+					if (term_in[c] || term_out[c] || fresh[c])
+						active.push_back(c);
+			}
+			active_first[levels] = (uint32_t)active.size();
+		}
+
+		/*
+		* @fn ActiveCount
+		* @brief Number of classes listed at a level, see BuildActiveClasses
+		*/
+		inline uint32_t ActiveCount(uint32_t level) const
+		{
+			return active_first[level + 1] - active_first[level];
+		}
+
+		/*
+		* @fn ActiveClasses
+		* @brief Classes listed at a level, by increasing id
+		*/
+		inline const uint32_t* ActiveClasses(uint32_t level) const
+		{
+			return active.data() + active_first[level];
+		}
+	};
+
+}
+
+#endif /* LEVELCLASSTABLES_HPP */
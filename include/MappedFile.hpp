@@ -0,0 +1,97 @@
+/**
+ * @file   MappedFile.hpp
+ * @brief  Read access to a whole file through a private memory mapping.
+ * @details On platforms without mmap the file is read in a single buffer.
+ */
+
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <Error.hpp>
+
+namespace vflib
+{
+	/**
+	* @class MappedFile
+	* @brief Maps a file in memory for its whole lifetime.
+	* @details The mapping is private: pages are shared with the page cache
+	* until they are written, and writes are never carried to the file.
+	*/
+	class MappedFile
+	{
+	private:
+		char *base;
+		size_t length;
+
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+	public:
+		/**
+		* @brief Maps a file.
+		* @param [in] filename Name of the file.
+		* @param [in] writable If TRUE the pages can be written (copy on write).
+		*/
+		MappedFile(const std::string &filename, bool writable = false) : base(NULL), length(0)
+		{
+#ifndef WIN32
+			int fd = open(filename.c_str(), O_RDONLY);
+			struct stat st;
+			if (fd < 0 || fstat(fd, &st) < 0)
+				error("Unable to open %s", filename.c_str());
+			length = (size_t)st.st_size;
+			if (length)
+			{
+				void *addr = mmap(NULL, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+					MAP_PRIVATE, fd, 0);
+				if (addr == MAP_FAILED)
+					error("Unable to map %s", filename.c_str());
+				base = (char*)addr;
+			}
+			close(fd);
+#else
+			FILE *f = fopen(filename.c_str(), "rb");
+			if (!f)
+				error("Unable to open %s", filename.c_str());
+			fseek(f, 0, SEEK_END);
+			length = (size_t)ftell(f);
+			fseek(f, 0, SEEK_SET);
+			if (length)
+			{
+				base = (char*)malloc(length);
+				if (!base || fread(base, 1, length, f) != length)
+					error("Unable to read %s", filename.c_str());
+			}
+			fclose(f);
+#endif
+		}
+
+		~MappedFile()
+		{
+			if (!base)
+				return;
+#ifndef WIN32
+			munmap(base, length);
+#else
+			free(base);
+#endif
+		}
+
+		char* Data() const { return base; }
+		size_t Size() const { return length; }
+	};
+}
+
+#endif /* MAPPEDFILE_HPP */
@@ -0,0 +1,201 @@
+/**
+ * @file   NeighborIntersection.hpp
+ * @brief  Candidates adjacent to the images of all the mapped neighbors.
+ * @details For a pattern node with more than one neighbor before it in the
+ * matching order, the candidates are the target nodes adjacent, with the
+ * right direction, to the images of all those neighbors. The neighbor
+ * lists of the images are intersected, the shortest first, by galloping
+ * search in the others, so that IsFeasiblePair only gets nodes whose core
+ * edges are already there.
+ */
+
+#ifndef NEIGHBORINTERSECTION_HPP
+#define NEIGHBORINTERSECTION_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <ARGraph.hpp>
+
+namespace vflib
+{
+	/*
+	* @class NeighborIntersection
+	* @brief Earlier neighbors of each pattern node, and a candidate buffer per depth
+	* @note The buffers are shared by all the states of a search, so the
+	* same object can't be used by searches running at the same time.
+	*/
+	class NeighborIntersection
+	{
+	private:
+		struct Constraint
+		{
+			nodeID_t node;	//< Neighbor before in the order
+			bool out;		//< TRUE for an edge from the neighbor to the node
+		};
+
+		struct List
+		{
+			const nodeID_t* nodes;
+			uint32_t count;
+		};
+
+		std::vector<uint32_t> first;				//< First constraint of each pattern node
+		std::vector<Constraint> constraints;
+		std::vector<std::vector<nodeID_t> > buffers;	//< Candidates found at each depth
+		std::vector<List> lists;
+		std::vector<uint32_t> cursors;
+
+		NeighborIntersection(const NeighborIntersection&);
+		NeighborIntersection& operator=(const NeighborIntersection&);
+
+		/*
+		* @fn Gallop
+		* @brief First position from pos with a node not less than the given one
+		*/
+		static uint32_t Gallop(const List &list, uint32_t pos, nodeID_t node)
+		{
+			uint32_t step = 1;
+			uint32_t hi = pos;
+			while (hi < list.count && list.nodes[hi] < node)
+			{
+				pos = hi + 1;
+				hi += step;
+				step <<= 1;
+			}
+			if (hi > list.count)
+				hi = list.count;
+			return (uint32_t)(std::lower_bound(list.nodes + pos, list.nodes + hi, node) - list.nodes);
+		}
+
+		template<typename Node, typename Edge>
+		static List NeighborsOfClass(ARGraph<Node, Edge>* g2, const uint32_t* class_2,
+			nodeID_t node, bool out, uint32_t c)
+		{
+			List list;
+			if (g2->HasClassIndex(class_2))
+				list.nodes = out ? g2->GetOutEdgesOfClass(node, c, list.count)
+					: g2->GetInEdgesOfClass(node, c, list.count);
+			else if (out)
+			{
+				list.nodes = g2->GetOutEdgeSet(node);
+				list.count = g2->OutEdgeCount(node);
+			}
+			else
+			{
+				list.nodes = g2->GetInEdgeSet(node);
+				list.count = g2->InEdgeCount(node);
+			}
+			return list;
+		}
+
+	public:
+		/*
+		* @fn NeighborIntersection
+		* @param [in] g1 Pattern
+		* @param [in] order Matching order of the pattern nodes
+		*/
+		template<typename Node, typename Edge>
+		NeighborIntersection(ARGraph<Node, Edge>* g1, const nodeID_t* order)
+		{
+			uint32_t n1 = g1->NodeCount();
+			std::vector<uint32_t> depth(n1);
+			nodeID_t u;
+			uint32_t i;
+
+			for (i = 0; i < n1; i++)
+				depth[order[i]] = i;
+
+			first.resize(n1 + 1);
+			for (u = 0; u < n1; u++)
+			{
+				first[u] = (uint32_t)constraints.size();
+				for (i = 0; i < g1->InEdgeCount(u); i++)
+				{
+					Constraint k = { g1->GetInEdge(u, i), true };
+					if (depth[k.node] < depth[u])
+						constraints.push_back(k);
+				}
+				for (i = 0; i < g1->OutEdgeCount(u); i++)
+				{
+					Constraint k = { g1->GetOutEdge(u, i), false };
+					if (depth[k.node] < depth[u])
+						constraints.push_back(k);
+				}
+			}
+			first[n1] = (uint32_t)constraints.size();
+			buffers.resize(n1);
+		}
+
+		/*
+		* @fn ConstraintCount
+		* @brief Number of neighbors of a pattern node before it in the order
+		*/
+		inline uint32_t ConstraintCount(nodeID_t n1) const
+		{
+			return first[n1 + 1] - first[n1];
+		}
+
+		/*
+		* @fn Intersect
+		* @brief Computes the target nodes of class c adjacent to the images
+		* of all the earlier neighbors of a pattern node
+		* @param [in] g2 Target
+		* @param [in] n1 Pattern node
+		* @param [in] depth Depth of the search, where the result is kept
+		* @param [in] core_1 Current mapping of the pattern nodes
+		* @param [in] class_2 Classes of the target nodes
+		* @param [in] c Class of the pattern node
+		* @returns The candidates, by increasing id
+		*/
+		template<typename Node, typename Edge>
+		const std::vector<nodeID_t>& Intersect(ARGraph<Node, Edge>* g2, nodeID_t n1,
+			uint32_t depth, const nodeID_t* core_1, const uint32_t* class_2, uint32_t c)
+		{
+			std::vector<nodeID_t> &result = buffers[depth];
+			uint32_t k, count = ConstraintCount(n1);
+
+			lists.resize(count);
+			cursors.assign(count, 0);
+			for (k = 0; k < count; k++)
+			{
+				const Constraint &cons = constraints[first[n1] + k];
+				lists[k] = NeighborsOfClass(g2, class_2, core_1[cons.node], cons.out, c);
+			}
+			std::sort(lists.begin(), lists.end(), [](const List &a, const List &b) {
+				return a.count < b.count;
+			});
+
+			result.clear();
+			for (uint32_t i = 0; i < lists[0].count; i++)
+			{
+				nodeID_t node = lists[0].nodes[i];
+				if (class_2[node] != c)
+					continue;
+				for (k = 1; k < count; k++)
+				{
+					cursors[k] = Gallop(lists[k], cursors[k], node);
+					if (cursors[k] == lists[k].count)
+						return result;
+					if (lists[k].nodes[cursors[k]] != node)
+						break;
+				}
+				if (k == count)
+					result.push_back(node);
+			}
+			return result;
+		}
+
+		/*
+		* @fn Candidates
+		* @brief Result of the last intersection at a depth
+		*/
+		inline const std::vector<nodeID_t>& Candidates(uint32_t depth) const
+		{
+			return buffers[depth];
+		}
+	};
+
+}
+
+#endif /* NEIGHBORINTERSECTION_HPP */
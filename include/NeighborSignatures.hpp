@@ -0,0 +1,110 @@
+/**
+ * @file   NeighborSignatures.hpp
+ * @brief  Fixed size summary of the neighbor classes of each node.
+ * @details Each node gets 16 counters of one byte: the first 8 count its
+ * out neighbors, the last 8 its in neighbors, by class modulo 8. The
+ * counters saturate at 255. A pattern node can be matched with a target
+ * node only if none of its counters is greater than the one of the target
+ * node, so that the check of a pair takes a few SSE2 instructions.
+ */
+
+#ifndef NEIGHBORSIGNATURES_HPP
+#define NEIGHBORSIGNATURES_HPP
+
+#include <vector>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIGNATURES_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <ARGraph.hpp>
+
+namespace vflib
+{
+	const uint32_t SIGNATURE_BUCKETS = 8;	/**<Counters for each direction */
+
+	/*
+	* @class NeighborSignatures
+	* @brief Signatures of the nodes of the pattern and of the target
+	*/
+	class NeighborSignatures
+	{
+	private:
+		struct Signature
+		{
+			uint8_t count[2 * SIGNATURE_BUCKETS];	//< Out counters, then in counters
+		};
+
+		std::vector<Signature> pattern;
+		std::vector<Signature> target;
+
+		NeighborSignatures(const NeighborSignatures&);
+		NeighborSignatures& operator=(const NeighborSignatures&);
+
+		static inline void Increment(uint8_t &count)
+		{
+			if (count < 255)
+				count++;
+		}
+
+		template<typename Node, typename Edge>
+		static void Compute(ARGraph<Node, Edge>* g, const uint32_t* classes,
+			std::vector<Signature> &signatures)
+		{
+			uint32_t count = g->NodeCount();
+			signatures.resize(count);
+			for (nodeID_t n = 0; n < count; n++)
+			{
+				Signature &s = signatures[n];
+				memset(s.count, 0, sizeof(s.count));
+				for (uint32_t i = 0; i < g->OutEdgeCount(n); i++)
+					Increment(s.count[classes[g->GetOutEdge(n, i)] % SIGNATURE_BUCKETS]);
+				for (uint32_t i = 0; i < g->InEdgeCount(n); i++)
+					Increment(s.count[SIGNATURE_BUCKETS + classes[g->GetInEdge(n, i)] % SIGNATURE_BUCKETS]);
+			}
+		}
+
+	public:
+		/*
+		* @fn NeighborSignatures
+		* @brief Computes the signatures of both the graphs
+		* @param [in] g1 Pattern
+		* @param [in] g2 Target
+		* @param [in] class_1 Classes of the pattern nodes
+		* @param [in] class_2 Classes of the target nodes
+		*/
+		template<typename Node1, typename Node2, typename Edge1, typename Edge2>
+		NeighborSignatures(ARGraph<Node1, Edge1>* g1, ARGraph<Node2, Edge2>* g2,
+			const uint32_t* class_1, const uint32_t* class_2)
+		{
+			Compute(g1, class_1, pattern);
+			Compute(g2, class_2, target);
+		}
+
+		/*
+		* @fn Compatible
+		* @brief FALSE if the pattern node has more neighbors of some classes
+		* than the target node, so that the two can't be matched
+		*/
+		inline bool Compatible(nodeID_t n1, nodeID_t n2) const
+		{
+#ifdef SIGNATURES_SSE2
+			__m128i p = _mm_loadu_si128((const __m128i*)pattern[n1].count);
+			__m128i t = _mm_loadu_si128((const __m128i*)target[n2].count);
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(p, t), t)) == 0xFFFF;
+#else
+			const uint8_t *p = pattern[n1].count;
+			const uint8_t *t = target[n2].count;
+			for (uint32_t i = 0; i < 2 * SIGNATURE_BUCKETS; i++)
+				if (p[i] > t[i])
+					return false;
+			return true;
+#endif
+		}
+	};
+
+}
+
+#endif /* NEIGHBORSIGNATURES_HPP */
@@ -89,19 +89,6 @@ namespace vflib
 		}
 	};
 
-	/*
-	* @class FindUnused
-	* @brief Used by std::find_if to find the first unused SortingNode
-	*/
-	class FindUnused
-	{
-	public:
-		bool operator()(SortingNode* node)
-		{
-			return !node->IsUsed();
-		}
-	};
-
 	template<typename Node, typename Edge>
 	class VF2NodeSorter :NodeSorter<Node, Edge>
 	{
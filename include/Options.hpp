@@ -8,6 +8,7 @@
 #include <cinttypes>
 #include <stdio.h>
 #include <iostream>
+#include <fstream>
 #include "VFLib.h"
 
 #define VF3PGSS	 (1)
@@ -32,6 +33,11 @@ struct OptionStructure
 	std::string format;
 	float repetitionTimeLimit;
 	bool edgeInduced;
+	uint32_t adjacencyBudget;
+	bool candidateDomains;
+	bool reduceTarget;
+	bool classIndex;
+	bool intersectCandidates;
 	OptionStructure() : pattern(nullptr),
 						target(nullptr),
 						undirected(false),
@@ -48,7 +54,16 @@ struct OptionStructure
 						verbose(0),
 						format("vf"),
 						edgeInduced(false), // by default the algorithm solves the node-induced subgraph isomorphism problem
-						repetitionTimeLimit(1)
+						repetitionTimeLimit(1),
+#ifdef VF3B
+						adjacencyBudget(1024),
+#else
+						adjacencyBudget(0),
+#endif
+						candidateDomains(true),
+						reduceTarget(false),
+						classIndex(false),
+						intersectCandidates(false)
 	{
 	}
 };
@@ -62,7 +77,10 @@ void PrintUsage()
 #ifdef VF3P
   outstring += "-c [start cpu] -t [# of threads] -a [version id] -h [SSR high limit] -l [local stack limit] -k ";
 #endif
-	outstring += "-u -s -f [graph format]";
+	outstring += "-u -s -p -n -f [graph format] -b [adjacency bitmap MB]";
+#ifndef VF3P
+	outstring += " -d -i";
+#endif
 	std::cout<<outstring<<std::endl;
 }
 
@@ -80,13 +98,19 @@ bool GetOptions(Options &opt, int argc, char **argv)
 	* -r Minimum time in second for benchmark repetitions. Default 1.
 	* -F Stop to first solution (not for parallel version)
 	* -s Print Solutions
-	* -f Graph format [vf, edge]
+	* -f Graph format [vf, vfstream, edge, bin, bin32, snap]
 	* -v Verbose: show all time
+	* -b Memory budget in MB for the adjacency bitmaps. Default 0, no bitmaps.
+	*    For VF3B, budget of the bitset rows of the target. Default 1024
+	* -p Match on the subgraph of the target nodes that pass the label, degree and neighbor labels filters
+	* -n Index the neighbors of the target nodes by class (takes another copy of the target edges)
+	* -d Disable the candidate domains of the pattern nodes (not for parallel version)
+	* -i Intersect the neighbors of all the mapped neighbors to get the candidates (not for parallel version)
 	*/
 #ifdef VF3P
-	std::string optionstring = ":a:c:t:r:f:h:l:sukv";
+	std::string optionstring = ":a:c:t:r:f:h:l:b:pnsukv";
 #else
-  std::string optionstring = ":r:f:suveF";
+  std::string optionstring = ":r:f:b:pnsuveFdi";
 #endif
 
 	char option;
@@ -132,10 +156,25 @@ bool GetOptions(Options &opt, int argc, char **argv)
 			case 'f':
 				opt.format = std::string(optarg);
 				break;
+			case 'b':
+				opt.adjacencyBudget = atoi(optarg);
+				break;
+			case 'p':
+				opt.reduceTarget = true;
+				break;
+			case 'n':
+				opt.classIndex = true;
+				break;
 #ifndef VF3P
             case 'F':
                 opt.firstOnly = true;
                 break;
+            case 'd':
+                opt.candidateDomains = false;
+                break;
+            case 'i':
+                opt.intersectCandidates = true;
+                break;
 #endif
             case '?':
 				PrintUsage();
@@ -156,23 +195,113 @@ bool GetOptions(Options &opt, int argc, char **argv)
 }
 
 template<typename Node, typename Edge>
-vflib::ARGLoader<Node, Edge>* CreateLoader(const Options& opt, std::istream &in)
+vflib::ARGLoader<Node, Edge>* CreateLoader(const Options& opt, const char* filename)
 {
-
 	if(opt.format == "vf")
-  {
+	{
+		return new vflib::ParallelTextARGLoader<Node, Edge>(filename, opt.undirected);
+	}
+
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	if(opt.format == "vfstream")
+	{
 		return new vflib::FastStreamARGLoader<Node, Edge>(in, opt.undirected);
-  }
+	}
 	else if(opt.format == "edge")
   {
 		return new vflib::EdgeStreamARGLoader<Node, Edge>(in, opt.undirected);
 	}
+	else if(opt.format == "bin")
+	{
+		return new vflib::BinaryARGLoader<Node, Edge, uint16_t>(in, opt.undirected);
+	}
+	else if(opt.format == "bin32")
+	{
+		return new vflib::BinaryARGLoader<Node, Edge, uint32_t>(in, opt.undirected);
+	}
 	else
 	{
 		return nullptr;
 	}
 }
 
+/**
+* @brief Loads a graph in the format selected by the options.
+* @details Snapshots (format snap) are memory mapped, the other
+* formats are parsed by the loader returned by CreateLoader.
+* @returns The graph, or nullptr if the format is unknown.
+*/
+template<typename Node, typename Edge>
+vflib::ARGraph<Node, Edge>* CreateGraph(const Options& opt, const char* filename)
+{
+	if(opt.format == "snap")
+	{
+		return new vflib::ARGraph<Node, Edge>(vflib::MapARGraphSnapshot<Node, Edge>(filename));
+	}
+
+	vflib::ARGLoader<Node, Edge>* loader = CreateLoader<Node, Edge>(opt, filename);
+	if(!loader)
+	{
+		return nullptr;
+	}
+
+	vflib::ARGraph<Node, Edge>* graph = new vflib::ARGraph<Node, Edge>(loader);
+	delete loader;
+	return graph;
+}
+
+/**
+* @brief Loads a graph replacing its node labels with their ids.
+* @details The labels read by the loader are interned in a dictionary,
+* that must be shared by all the graphs to be matched.
+* Snapshots are not supported, since they can't store the labels.
+* @returns The graph, or nullptr if the format is unknown.
+*/
+template<typename Label, typename Edge>
+vflib::ARGraph<uint32_t, Edge>* CreateGraph(const Options& opt, const char* filename,
+	vflib::LabelDictionary<Label>& labels)
+{
+	vflib::ARGLoader<Label, Edge>* loader = CreateLoader<Label, Edge>(opt, filename);
+	if(!loader)
+	{
+		return nullptr;
+	}
+
+	vflib::InterningARGLoader<Label, Edge> interning(loader, labels);
+	vflib::ARGraph<uint32_t, Edge>* graph = new vflib::ARGraph<uint32_t, Edge>(&interning);
+	delete loader;
+	return graph;
+}
+
+/**
+* @brief Gets the profile of the target graph.
+* @details A snapshot can have its profile saved next to it, with
+* the extension .prof; if it is found and fits the graph it is loaded,
+* otherwise the profile is computed.
+*/
+template<typename Node, typename Edge>
+std::shared_ptr<const vflib::TargetProfile<Node, Edge> > CreateTargetProfile(const Options& opt,
+	vflib::ARGraph<Node, Edge>* target)
+{
+	if(opt.format == "snap")
+	{
+		std::string filename = std::string(opt.target) + ".prof";
+		if(std::ifstream(filename.c_str()).good())
+		{
+			std::shared_ptr<const vflib::TargetProfile<Node, Edge> > profile =
+				std::make_shared<vflib::TargetProfile<Node, Edge> >(filename);
+			if(profile->Matches(target))
+			{
+				return profile;
+			}
+		}
+	}
+
+	return std::make_shared<vflib::TargetProfile<Node, Edge> >(target);
+}
+
+#if defined(VF3) || defined(VF3L) || defined(VF3B) || defined(VF3P)
+
 vflib::MatchingEngine<state_t>* CreateMatchingEngine(const Options& opt)
 {
 #ifdef VF3P
@@ -189,9 +318,10 @@ vflib::MatchingEngine<state_t>* CreateMatchingEngine(const Options& opt)
 			std::cout<<"2: VF3P with Local Stack and limited depth\n";
 			return nullptr;
 	}
-#elif defined(VF3) || defined(VF3L)
+#elif defined(VF3) || defined(VF3L) || defined(VF3B)
     return new vflib::MatchingEngine<state_t >(opt.storeSolutions, opt.edgeInduced);
 #endif
 }
+#endif
 
 #endif /* OPTIONS */
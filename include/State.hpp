@@ -14,6 +14,7 @@
 #include <vector>
 #include <Error.hpp>
 #include <ARGraph.hpp>
+#include <TargetWorkspace.hpp>
 
 #ifdef TRACE
 #include <StateTrace.hpp>
@@ -46,22 +47,49 @@ namespace vflib
 		nodeID_t *core_1;
 		nodeID_t *core_2;
 
+		TargetWorkspace *workspace;  //Records of the target nodes, NULL if the state uses core_2
+		uint64_t generation;         //Search of the workspace
+		bool own_workspace;          //If true, the workspace is private to the search
+
 		int64_t *share_count;  //Count the number of instances sharing the common sets
 
 		//PRIVATE METHODS
 		virtual void BackTrack() = 0;
 
-	public:
-		State(uint32_t n1, uint32_t n2, nodeID_t *order, bool edgeInduced)
+		/*
+		* Constructor for the states keeping the core set of the target in
+		* the records of a workspace. Without a workspace a private one is made.
+		* The workspace must be bound to the classes of the target nodes.
+		*/
+		State(uint32_t n1, uint32_t n2, nodeID_t *order, bool edgeInduced,
+			const uint32_t *class_2, TargetWorkspace *workspace)
 		{
+			Init(n1, n2, order, edgeInduced);
+
+			if (workspace && workspace->NodeCount() != n2)
+			{
+				error("Workspace of %u nodes for a target of %u nodes", workspace->NodeCount(), n2);
+			}
+			if (workspace && workspace->Classes() != class_2)
+			{
+				error("Workspace bound to other classes than the ones of the target");
+			}
 
+			own_workspace = (workspace == NULL);
+			this->workspace = own_workspace ? new TargetWorkspace(n2, class_2) : workspace;
+			generation = this->workspace->Acquire();
+			core_2 = NULL;
+		}
+
+	private:
+		void Init(uint32_t n1, uint32_t n2, nodeID_t *order, bool edgeInduced)
+		{
 			this->order = order;
 			this->edgeInduced = edgeInduced;
 			this->n1 = n1;
 			this->n2 = n2;
 
 			core_1 = new nodeID_t[n1];
-			core_2 = new nodeID_t[n2];
 			core_len = orig_core_len = 0;
 			share_count = new int64_t;
 			added_node1 = NULL_NODE;
@@ -69,7 +97,7 @@ namespace vflib
 			used = false;
 			parent = NULL;
 
-			if (!core_1 || !core_2 || !share_count)
+			if (!core_1 || !share_count)
 			{
 				error("Out of memory");
 			}
@@ -80,12 +108,28 @@ namespace vflib
 				core_1[i] = NULL_NODE;
 			}
 
-			for (i = 0; i < n2; i++)
+			*share_count = 1;
+		}
+
+	public:
+		State(uint32_t n1, uint32_t n2, nodeID_t *order, bool edgeInduced)
+		{
+			Init(n1, n2, order, edgeInduced);
+
+			workspace = NULL;
+			generation = 0;
+			own_workspace = false;
+			core_2 = new nodeID_t[n2];
+
+			if (!core_2)
 			{
-				core_2[i] = NULL_NODE;
+				error("Out of memory");
 			}
 
-			*share_count = 1;
+			for (uint32_t i = 0; i < n2; i++)
+			{
+				core_2[i] = NULL_NODE;
+			}
 		}
 
 		State(const State& state)
@@ -97,6 +141,9 @@ namespace vflib
 			n2 = state.n2;
 			core_1 = state.core_1;
 			core_2 = state.core_2;
+			workspace = state.workspace;
+			generation = state.generation;
+			own_workspace = state.own_workspace;
 
 			added_node1 = NULL_NODE;
 			core_len = orig_core_len = state.core_len;
@@ -115,6 +162,12 @@ namespace vflib
 			{
 				delete[] core_1;
 				delete[] core_2;
+				if (workspace)
+				{
+					workspace->Release(generation);
+					if (own_workspace)
+						delete workspace;
+				}
 				delete share_count;
 			}
 		}
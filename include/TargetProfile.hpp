@@ -0,0 +1,381 @@
+/**
+ * @file   TargetProfile.hpp
+ * @brief  Degree distributions and label frequencies of a target graph.
+ * @details The profile is what the node probability strategies need to
+ * know about the target: how many nodes have a given in, out and total
+ * degree (and at least that degree), and how many nodes carry each
+ * label. It is computed once per target and can be shared by any number
+ * of sorters and queries, or saved next to the graph to be loaded back
+ * on a warm restart.
+ */
+
+#ifndef TARGETPROFILE_HPP
+#define TARGETPROFILE_HPP
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <type_traits>
+
+#include "ARGraph.hpp"
+
+namespace vflib
+{
+	const char PROFILE_MAGIC[8] = { 'V', 'F', '3', 'P', 'R', 'O', 'F', '\0' };	/**<Magic string of the profile files */
+	const uint32_t PROFILE_VERSION = 1;				/**<Version of the profile format */
+	const uint32_t PROFILE_BYTE_ORDER = 0x01020304;		/**<Marker used to detect a different byte order */
+	const uint32_t PROFILE_PARALLEL_MIN_NODES = 1 << 16;	/**<Min number of nodes to compute a profile on several threads */
+	const uint64_t PROFILE_DENSE_LABEL_LIMIT = 1 << 20;	/**<Max integer label looked up by direct indexing */
+
+	/**
+	* @brief Header of a profile file.
+	*/
+	struct TargetProfileHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t node_attr_size;
+		uint32_t node_count;
+		uint32_t edge_count;
+		uint32_t out_size;
+		uint32_t in_size;
+		uint32_t degree_size;
+		uint32_t label_count;
+		uint32_t reserved;
+	};
+
+	/**
+	* @brief Gets the index of an integer label for direct lookup.
+	* @returns FALSE if the label can't be used as an index.
+	*/
+	template <typename T>
+	inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+	ProfileLabelIndex(const T &label, uint64_t &index)
+	{
+		if (std::is_signed<T>::value && label < T(0))
+			return false;
+		index = (uint64_t)label;
+		return index < PROFILE_DENSE_LABEL_LIMIT;
+	}
+
+	template <typename T>
+	inline typename std::enable_if<!std::is_integral<T>::value, bool>::type
+	ProfileLabelIndex(const T &label, uint64_t &index)
+	{
+		return false;
+	}
+
+	/**
+	* @class TargetProfile
+	* @brief Precomputed statistics of a target graph.
+	* @details Degree counts are stored as cumulative arrays, so that the
+	* number of nodes with at least a given degree is a single lookup.
+	* Labels are kept sorted with their counts; integer labels in a small
+	* range are also indexed directly.
+	*/
+	template<typename Node, typename Edge>
+	class TargetProfile
+	{
+	private:
+		uint32_t node_count;
+		uint32_t edge_count;
+		std::vector<uint32_t> out_at_least;	//< Nodes with out degree >= d, with a final 0
+		std::vector<uint32_t> in_at_least;	//< Nodes with in degree >= d, with a final 0
+		std::vector<uint32_t> deg_at_least;	//< Nodes with degree >= d, with a final 0
+		std::vector<Node> label_values;		//< Distinct labels, sorted
+		std::vector<uint32_t> label_counts;	//< Nodes with each label in label_values
+		std::vector<uint32_t> dense_counts;	//< Nodes with each label, indexed by the label, if possible
+
+		TargetProfile(const TargetProfile&);
+		TargetProfile& operator=(const TargetProfile&);
+
+		static void Accumulate(std::vector<uint32_t> &counts)
+		{
+			for (size_t d = counts.size() - 1; d > 0; d--)
+				counts[d - 1] += counts[d];
+		}
+
+		static double Exact(const std::vector<uint32_t> &counts, uint32_t d, uint32_t total)
+		{
+			return (size_t)d + 1 < counts.size() ? ((double)(counts[d] - counts[d + 1])) / total : 0.0;
+		}
+
+		static double Ratio(const std::vector<uint32_t> &counts, uint32_t d, uint32_t total)
+		{
+			return d < counts.size() ? ((double)counts[d]) / total : 0.0;
+		}
+
+		void BuildDenseLabels()
+		{
+			uint64_t index, max_index = 0;
+			size_t i;
+
+			dense_counts.clear();
+			for (i = 0; i < label_values.size(); i++)
+			{
+				if (!ProfileLabelIndex(label_values[i], index))
+					return;
+				max_index = std::max(max_index, index);
+			}
+			if (label_values.empty())
+				return;
+
+			dense_counts.assign(max_index + 1, 0);
+			for (i = 0; i < label_values.size(); i++)
+			{
+				ProfileLabelIndex(label_values[i], index);
+				dense_counts[index] = label_counts[i];
+			}
+		}
+
+		void Evaluate(ARGraph<Node, Edge>* g, uint32_t threads);
+
+	public:
+		TargetProfile(ARGraph<Node, Edge>* g, uint32_t threads = 0);
+		TargetProfile(const std::string &filename);
+
+		void Save(const std::string &filename) const;
+
+		/**
+		* @brief Checks if the profile may have been computed on a graph.
+		* @param [in] g Graph.
+		* @returns TRUE if the graph has the same nodes and edges count.
+		*/
+		bool Matches(ARGraph<Node, Edge>* g) const
+		{
+			return g->NodeCount() == node_count && g->EdgeCount() == edge_count;
+		}
+
+		/**
+		* @brief Number of nodes of the target.
+		*/
+		uint32_t NodeCount() const { return node_count; }
+
+		/**
+		* @brief Fraction of the nodes with out degree exactly d.
+		*/
+		double OutDegreeProbability(uint32_t d) const
+		{
+			return Exact(out_at_least, d, node_count);
+		}
+
+		/**
+		* @brief Fraction of the nodes with in degree exactly d.
+		*/
+		double InDegreeProbability(uint32_t d) const
+		{
+			return Exact(in_at_least, d, node_count);
+		}
+
+		/**
+		* @brief Fraction of the nodes with degree exactly d.
+		*/
+		double DegreeProbability(uint32_t d) const
+		{
+			return Exact(deg_at_least, d, node_count);
+		}
+
+		/**
+		* @brief Fraction of the nodes with out degree at least d.
+		*/
+		double OutDegreeAtLeast(uint32_t d) const { return Ratio(out_at_least, d, node_count); }
+
+		/**
+		* @brief Fraction of the nodes with in degree at least d.
+		*/
+		double InDegreeAtLeast(uint32_t d) const { return Ratio(in_at_least, d, node_count); }
+
+		/**
+		* @brief Fraction of the nodes with degree at least d.
+		*/
+		double DegreeAtLeast(uint32_t d) const { return Ratio(deg_at_least, d, node_count); }
+
+		/**
+		* @brief Fraction of the nodes with a given label.
+		* @returns 0 if no node of the target has the label.
+		*/
+		double LabelProbability(const Node &label) const
+		{
+			uint64_t index;
+			if (!dense_counts.empty())
+			{
+				if (!ProfileLabelIndex(label, index) || index >= dense_counts.size())
+					return 0.0;
+				return ((double)dense_counts[index]) / node_count;
+			}
+
+			typename std::vector<Node>::const_iterator it =
+				std::lower_bound(label_values.begin(), label_values.end(), label);
+			if (it == label_values.end() || label < *it)
+				return 0.0;
+			return ((double)label_counts[it - label_values.begin()]) / node_count;
+		}
+	};
+
+	/**
+	* @brief Computes the profile of a graph.
+	* @param [in] g Target graph.
+	* @param [in] threads Number of threads, 0 to use all the available cores.
+	* Small graphs are always profiled on a single thread.
+	*/
+	template<typename Node, typename Edge>
+	TargetProfile<Node, Edge>::TargetProfile(ARGraph<Node, Edge>* g, uint32_t threads)
+	{
+		if (!threads)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		if (g->NodeCount() < PROFILE_PARALLEL_MIN_NODES)
+			threads = 1;
+		Evaluate(g, threads);
+	}
+
+	/**
+	* @brief Counts degrees and labels, each thread on a range of nodes.
+	*/
+	template<typename Node, typename Edge>
+	void TargetProfile<Node, Edge>::Evaluate(ARGraph<Node, Edge>* g, uint32_t threads)
+	{
+		uint32_t t;
+		size_t d;
+
+		node_count = g->NodeCount();
+		edge_count = g->EdgeCount();
+
+		std::vector<std::vector<uint32_t> > out_counts(threads), in_counts(threads), deg_counts(threads);
+		std::vector<std::map<Node, uint32_t> > label_maps(threads);
+		std::vector<std::thread> pool;
+
+		for (t = 0; t < threads; t++)
+		{
+			pool.push_back(std::thread([&, t]() {
+				nodeID_t first = (nodeID_t)((uint64_t)node_count * t / threads);
+				nodeID_t last = (nodeID_t)((uint64_t)node_count * (t + 1) / threads);
+				out_counts[t].assign(g->OutMaxDegree() + 2, 0);
+				in_counts[t].assign(g->InMaxDegree() + 2, 0);
+				deg_counts[t].assign(g->MaxDegree() + 2, 0);
+				for (nodeID_t n = first; n < last; n++)
+				{
+					out_counts[t][g->OutEdgeCount(n)]++;
+					in_counts[t][g->InEdgeCount(n)]++;
+					deg_counts[t][g->EdgeCount(n)]++;
+					label_maps[t][g->GetNodeAttr(n)]++;
+				}
+			}));
+		}
+		for (t = 0; t < threads; t++)
+			pool[t].join();
+
+		out_at_least.swap(out_counts[0]);
+		in_at_least.swap(in_counts[0]);
+		deg_at_least.swap(deg_counts[0]);
+		for (t = 1; t < threads; t++)
+		{
+			for (d = 0; d < out_at_least.size(); d++)
+				out_at_least[d] += out_counts[t][d];
+			for (d = 0; d < in_at_least.size(); d++)
+				in_at_least[d] += in_counts[t][d];
+			for (d = 0; d < deg_at_least.size(); d++)
+				deg_at_least[d] += deg_counts[t][d];
+			typename std::map<Node, uint32_t>::iterator it;
+			for (it = label_maps[t].begin(); it != label_maps[t].end(); ++it)
+				label_maps[0][it->first] += it->second;
+		}
+		Accumulate(out_at_least);
+		Accumulate(in_at_least);
+		Accumulate(deg_at_least);
+
+		label_values.clear();
+		label_counts.clear();
+		typename std::map<Node, uint32_t>::iterator it;
+		for (it = label_maps[0].begin(); it != label_maps[0].end(); ++it)
+		{
+			label_values.push_back(it->first);
+			label_counts.push_back(it->second);
+		}
+		BuildDenseLabels();
+	}
+
+	/**
+	* @brief Writes the profile to a file.
+	* @note Only profiles with trivially copyable labels can be saved.
+	* @param [in] filename Name of the file.
+	*/
+	template<typename Node, typename Edge>
+	void TargetProfile<Node, Edge>::Save(const std::string &filename) const
+	{
+		TargetProfileHeader h;
+
+		if (!std::is_trivially_copyable<Node>::value)
+			error("Profiles require trivially copyable node attributes");
+
+		memset(&h, 0, sizeof(h));
+		memcpy(h.magic, PROFILE_MAGIC, sizeof(h.magic));
+		h.version = PROFILE_VERSION;
+		h.byte_order = PROFILE_BYTE_ORDER;
+		h.node_attr_size = sizeof(Node);
+		h.node_count = node_count;
+		h.edge_count = edge_count;
+		h.out_size = (uint32_t)out_at_least.size();
+		h.in_size = (uint32_t)in_at_least.size();
+		h.degree_size = (uint32_t)deg_at_least.size();
+		h.label_count = (uint32_t)label_values.size();
+
+		FILE *f = fopen(filename.c_str(), "wb");
+		if (!f)
+			error("Unable to open profile %s", filename.c_str());
+		if (fwrite(&h, sizeof(h), 1, f) != 1 ||
+			fwrite(out_at_least.data(), sizeof(uint32_t), h.out_size, f) != h.out_size ||
+			fwrite(in_at_least.data(), sizeof(uint32_t), h.in_size, f) != h.in_size ||
+			fwrite(deg_at_least.data(), sizeof(uint32_t), h.degree_size, f) != h.degree_size ||
+			fwrite(label_values.data(), sizeof(Node), h.label_count, f) != h.label_count ||
+			fwrite(label_counts.data(), sizeof(uint32_t), h.label_count, f) != h.label_count)
+			error("Unable to write profile %s", filename.c_str());
+		if (fclose(f))
+			error("Unable to write profile %s", filename.c_str());
+	}
+
+	/**
+	* @brief Reads a profile written by Save.
+	* @param [in] filename Name of the file.
+	*/
+	template<typename Node, typename Edge>
+	TargetProfile<Node, Edge>::TargetProfile(const std::string &filename)
+	{
+		TargetProfileHeader h;
+
+		if (!std::is_trivially_copyable<Node>::value)
+			error("Profiles require trivially copyable node attributes");
+
+		FILE *f = fopen(filename.c_str(), "rb");
+		if (!f)
+			error("Unable to open profile %s", filename.c_str());
+		if (fread(&h, sizeof(h), 1, f) != 1 ||
+			memcmp(h.magic, PROFILE_MAGIC, sizeof(h.magic)) || h.version != PROFILE_VERSION ||
+			h.byte_order != PROFILE_BYTE_ORDER || h.node_attr_size != sizeof(Node) ||
+			!h.out_size || !h.in_size || !h.degree_size)
+			error("Invalid profile %s", filename.c_str());
+
+		node_count = h.node_count;
+		edge_count = h.edge_count;
+		out_at_least.resize(h.out_size);
+		in_at_least.resize(h.in_size);
+		deg_at_least.resize(h.degree_size);
+		label_values.resize(h.label_count);
+		label_counts.resize(h.label_count);
+		if (fread(out_at_least.data(), sizeof(uint32_t), h.out_size, f) != h.out_size ||
+			fread(in_at_least.data(), sizeof(uint32_t), h.in_size, f) != h.in_size ||
+			fread(deg_at_least.data(), sizeof(uint32_t), h.degree_size, f) != h.degree_size ||
+			fread(label_values.data(), sizeof(Node), h.label_count, f) != h.label_count ||
+			fread(label_counts.data(), sizeof(uint32_t), h.label_count, f) != h.label_count)
+			error("Truncated profile %s", filename.c_str());
+		fclose(f);
+		BuildDenseLabels();
+	}
+}
+
+#endif /* TARGETPROFILE_HPP */
@@ -0,0 +1,208 @@
+/**
+ * @file   TargetReduction.hpp
+ * @brief  Subgraph of the target induced by the nodes that can be matched.
+ * @details A target node is viable if it passes the NeighborClassFilter of
+ * some pattern node of its class, counting only its viable neighbors.
+ * Removing a node can make its neighbors fail the filter, so the nodes are
+ * checked again until a fixpoint is reached. Every node of a solution is
+ * viable, so the search can run on the reduced graph, whose size depends
+ * only on the part of the target similar to the pattern.
+ */
+
+#ifndef TARGETREDUCTION_HPP
+#define TARGETREDUCTION_HPP
+
+#include <vector>
+
+#include <ARGraph.hpp>
+#include <CandidateDomains.hpp>
+#include <MatchingEngine.hpp>
+
+namespace vflib
+{
+	/*
+	* @class TargetReduction
+	* @brief Reduced target, with the map of its nodes to the original ones
+	*/
+	template<typename Node, typename Edge>
+	class TargetReduction
+	{
+	private:
+		ARGraph<Node, Edge>* reduced;
+		std::vector<nodeID_t> original;		//< Original id of each node of the reduced graph
+		std::vector<uint32_t> classes;		//< Class of each node of the reduced graph
+
+		TargetReduction(const TargetReduction&);
+		TargetReduction& operator=(const TargetReduction&);
+
+	public:
+		/*
+		* @fn TargetReduction
+		* @param [in] g1 Pattern
+		* @param [in] g2 Target
+		* @param [in] class_1 Classes of the pattern nodes
+		* @param [in] class_2 Classes of the target nodes
+		* @param [in] classes_count Number of classes
+		*/
+		template<typename Node1, typename Edge1>
+		TargetReduction(ARGraph<Node1, Edge1>* g1, ARGraph<Node, Edge>* g2,
+			const std::vector<uint32_t>& class_1, const std::vector<uint32_t>& class_2,
+			uint32_t classes_count)
+		{
+			NeighborClassFilter filter(g1, class_1, classes_count);
+			uint32_t n2 = g2->NodeCount();
+			nodeID_t v, w;
+			uint32_t i;
+
+			//Every node is checked once, and again when a neighbor is removed
+			std::vector<bool> viable(n2), queued(n2);
+			std::vector<nodeID_t> queue;
+			for (v = 0; v < n2; v++)
+			{
+				uint32_t c = class_2[v];
+				viable[v] = queued[v] = filter.ClassBegin(c) < filter.ClassEnd(c);
+				if (viable[v])
+					queue.push_back(v);
+			}
+
+			std::vector<uint32_t> out_c(classes_count, 0), in_c(classes_count, 0);
+			std::vector<uint32_t> touched;
+			while (!queue.empty())
+			{
+				v = queue.back();
+				queue.pop_back();
+				queued[v] = false;
+
+				uint32_t out_deg = 0, in_deg = 0;
+				for (i = 0; i < g2->OutEdgeCount(v); i++)
+				{
+					w = g2->GetOutEdge(v, i);
+					if (!viable[w])
+						continue;
+					if (!out_c[class_2[w]] && !in_c[class_2[w]])
+						touched.push_back(class_2[w]);
+					out_c[class_2[w]]++;
+					out_deg++;
+				}
+				for (i = 0; i < g2->InEdgeCount(v); i++)
+				{
+					w = g2->GetInEdge(v, i);
+					if (!viable[w])
+						continue;
+					if (!out_c[class_2[w]] && !in_c[class_2[w]])
+						touched.push_back(class_2[w]);
+					in_c[class_2[w]]++;
+					in_deg++;
+				}
+
+				bool admitted = false;
+				uint32_t c = class_2[v];
+				for (uint32_t k = filter.ClassBegin(c); k < filter.ClassEnd(c) && !admitted; k++)
+				{
+					nodeID_t u = filter.PatternNode(k);
+					admitted = filter.AdmitsDegree(u, out_deg, in_deg)
+						&& filter.AdmitsNeighbors(u, out_c.data(), in_c.data());
+				}
+
+				for (i = 0; i < touched.size(); i++)
+					out_c[touched[i]] = in_c[touched[i]] = 0;
+				touched.clear();
+
+				if (admitted)
+					continue;
+
+				viable[v] = false;
+				for (i = 0; i < g2->OutEdgeCount(v); i++)
+				{
+					w = g2->GetOutEdge(v, i);
+					if (viable[w] && !queued[w])
+					{
+						queued[w] = true;
+						queue.push_back(w);
+					}
+				}
+				for (i = 0; i < g2->InEdgeCount(v); i++)
+				{
+					w = g2->GetInEdge(v, i);
+					if (viable[w] && !queued[w])
+					{
+						queued[w] = true;
+						queue.push_back(w);
+					}
+				}
+			}
+
+			//Induced subgraph, keeping the relative order of the nodes so
+			//that the rows of the edges stay sorted
+			std::vector<nodeID_t> id(n2, NULL_NODE);
+			for (v = 0; v < n2; v++)
+			{
+				if (viable[v])
+				{
+					id[v] = (nodeID_t)original.size();
+					original.push_back(v);
+					classes.push_back(class_2[v]);
+				}
+			}
+
+			ARGraphData<Node, Edge> data;
+			uint32_t count = (uint32_t)original.size();
+			data.attr.resize(count);
+			data.out_offset.resize(count + 1);
+			data.out_offset[0] = 0;
+			for (v = 0; v < count; v++)
+			{
+				nodeID_t o = original[v];
+				data.attr[v] = g2->GetNodeAttr(o);
+				for (i = 0; i < g2->OutEdgeCount(o); i++)
+				{
+					Edge attr;
+					w = g2->GetOutEdge(o, i, attr);
+					if (id[w] == NULL_NODE)
+						continue;
+					data.out_nodes.push_back(id[w]);
+					if (EdgeAttrTraits<Edge>::stored)
+						data.out_attr.push_back(attr);
+				}
+				data.out_offset[v + 1] = (uint32_t)data.out_nodes.size();
+			}
+			reduced = new ARGraph<Node, Edge>(std::move(data));
+		}
+
+		~TargetReduction()
+		{
+			delete reduced;
+		}
+
+		/*
+		* @fn GetGraph
+		* @brief Reduced target, owned by this object
+		*/
+		inline ARGraph<Node, Edge>* GetGraph() const { return reduced; }
+
+		/*
+		* @fn GetClasses
+		* @brief Classes of the nodes of the reduced target
+		*/
+		inline const std::vector<uint32_t>& GetClasses() const { return classes; }
+
+		/*
+		* @fn GetOriginalNode
+		* @brief Id in the target of a node of the reduced target
+		*/
+		inline nodeID_t GetOriginalNode(nodeID_t n) const { return original[n]; }
+
+		/*
+		* @fn RestoreSolution
+		* @brief Replaces the nodes of the reduced target in a solution with the original ones
+		*/
+		void RestoreSolution(MatchingSolution& sol) const
+		{
+			for (MatchingSolution::iterator it = sol.begin(); it != sol.end(); it++)
+				it->second = original[it->second];
+		}
+	};
+
+}
+
+#endif /* TARGETREDUCTION_HPP */
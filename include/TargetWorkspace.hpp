@@ -0,0 +1,135 @@
+/**
+ * @file   TargetWorkspace.hpp
+ * @brief  Per-node records of the target reused by the searches of many patterns.
+ * @details A state sets up the core set of the target, and the VF3 states
+ * also its terminal sets, with an entry per target node. On a large target
+ * matched against many small patterns this setup dwarfs the search.
+ * The backtracking of the states restores every entry they set, so when the
+ * last state of a search is gone the records are clean again: a workspace
+ * keeps them for the whole life of the target, and each search only pays
+ * for the arrays of the pattern.
+ * Each search takes a new generation of the workspace and stamps it as
+ * released at the end; a search starting on a generation that was not
+ * released (its states are still alive) resets the records first.
+ * The mapping, the class and the terminal depths of a node are packed in a
+ * single 16 bytes record, so the feasibility check reads one cache line for
+ * each neighbor of the candidate instead of four.
+ * The classes of the target are bound once, when the workspace is made:
+ * the records and the nodes by class only depend on the target. The classes
+ * that only appear in a pattern have no target node.
+ */
+
+#ifndef TARGETWORKSPACE_HPP
+#define TARGETWORKSPACE_HPP
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+#include <ARGraph.hpp>
+#include <ClassNodeIndex.hpp>
+
+namespace vflib
+{
+	/*
+	* @struct TargetNodeRecord
+	* @brief Search data of a target node
+	*/
+	struct alignas(16) TargetNodeRecord
+	{
+		nodeID_t core;		//< Pattern node mapped to the node, NULL_NODE if unmapped
+		uint32_t cls;		//< Class of the node
+		nodeID_t in;		//< Depth at which the node entered the in terminal set, 0 if not in it
+		nodeID_t out;		//< Depth at which the node entered the out terminal set, 0 if not in it
+	};
+
+	static_assert(sizeof(TargetNodeRecord) == 16, "A target node record must fit 16 bytes");
+
+	/*
+	* @class TargetWorkspace
+	* @brief Records of the target nodes, shared by the searches in turn
+	* @note A workspace can be used by one search at a time
+	*/
+	class TargetWorkspace
+	{
+	private:
+		uint32_t count;
+		std::vector<TargetNodeRecord> records;
+		uint64_t generation;			//< Generation of the last search
+		uint64_t released;				//< Generation of the last search that left the arrays clean
+		const uint32_t* classes;		//< Classes of the target nodes the workspace is bound to
+		std::shared_ptr<const ClassNodeIndex> class_nodes;
+
+		TargetWorkspace(const TargetWorkspace&);
+		TargetWorkspace& operator=(const TargetWorkspace&);
+
+	public:
+		/*
+		* @fn TargetWorkspace
+		* @param [in] count Number of nodes of the target
+		* @param [in] classes Class of each target node
+		* @note The classes must outlive the workspace and must not change
+		*/
+		TargetWorkspace(uint32_t count, const uint32_t* classes)
+			:count(count), generation(0), released(0), classes(classes)
+		{
+			uint32_t classes_count = 0;
+			records.resize(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				TargetNodeRecord clean = { NULL_NODE, classes[i], 0, 0 };
+				records[i] = clean;
+				if (classes[i] >= classes_count)
+					classes_count = classes[i] + 1;
+			}
+			class_nodes = std::make_shared<ClassNodeIndex>(classes, count, classes_count);
+		}
+
+		inline uint32_t NodeCount() const { return count; }
+
+		/*
+		* @fn Acquire
+		* @brief Starts a search on the workspace
+		* @returns The generation of the search, to be given back to Release
+		*/
+		uint64_t Acquire()
+		{
+			if (released != generation)
+			{
+				for (uint32_t i = 0; i < count; i++)
+				{
+					records[i].core = NULL_NODE;
+					records[i].in = records[i].out = 0;
+				}
+			}
+			return ++generation;
+		}
+
+		/*
+		* @fn Release
+		* @brief Ends a search, once all its states have been destroyed
+		*/
+		inline void Release(uint64_t search)
+		{
+			if (search == generation)
+				released = search;
+		}
+
+		inline TargetNodeRecord* Records() { return records.data(); }
+
+		/*
+		* @fn Classes
+		* @brief Classes of the target nodes the workspace is bound to
+		*/
+		inline const uint32_t* Classes() const { return classes; }
+
+		/*
+		* @fn ClassNodes
+		* @brief Nodes of the target by class
+		*/
+		inline std::shared_ptr<const ClassNodeIndex> ClassNodes() const { return class_nodes; }
+	};
+
+}
+
+#endif /* TARGETWORKSPACE_HPP */
@@ -311,7 +311,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(node2, other2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 			else
@@ -333,7 +333,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(other2, node2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 			else
@@ -0,0 +1,566 @@
+/*----------------------------------------------------
+ * @file   VF3BitSubState.hpp
+ * @brief Definition of a state of the matching process working on
+ * bitsets of the target nodes, for small and dense targets.
+ *--------------------------------------------------*/
+
+#ifndef VF3_BIT_SUB_STATE_HPP
+#define VF3_BIT_SUB_STATE_HPP
+
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <ARGraph.hpp>
+#include <State.hpp>
+#include <NeighborSignatures.hpp>
+#include <Error.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BIT_STATE_X86
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace vflib
+{
+	const uint32_t BIT_STATE_MAX_NODES = 1 << 16;	/**<Max number of target nodes, each of them has an adjacency row of this many bits */
+
+	/*----------------------------------------------------------
+	 * Word operations on the bitsets. The AVX2 and AVX-512
+	 * versions are chosen at run time, if the CPU has them.
+	 ---------------------------------------------------------*/
+	namespace bitrows
+	{
+		typedef void(*RowOperation)(uint64_t* dst, const uint64_t* src, size_t words);
+
+		//dst &= src
+		inline void And(uint64_t* dst, const uint64_t* src, size_t words)
+		{
+			for (size_t i = 0; i < words; i++)
+				dst[i] &= src[i];
+		}
+
+		//dst &= ~src
+		inline void AndNot(uint64_t* dst, const uint64_t* src, size_t words)
+		{
+			for (size_t i = 0; i < words; i++)
+				dst[i] &= ~src[i];
+		}
+
+#ifdef BIT_STATE_X86
+		__attribute__((target("avx2")))
+		inline void AndAvx2(uint64_t* dst, const uint64_t* src, size_t words)
+		{
+			size_t i = 0;
+			for (; i + 4 <= words; i += 4)
+			{
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+				_mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(d, s));
+			}
+			for (; i < words; i++)
+				dst[i] &= src[i];
+		}
+
+		__attribute__((target("avx2")))
+		inline void AndNotAvx2(uint64_t* dst, const uint64_t* src, size_t words)
+		{
+			size_t i = 0;
+			for (; i + 4 <= words; i += 4)
+			{
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+				_mm256_storeu_si256((__m256i*)(dst + i), _mm256_andnot_si256(s, d));
+			}
+			for (; i < words; i++)
+				dst[i] &= ~src[i];
+		}
+
+		__attribute__((target("avx512f")))
+		inline void AndAvx512(uint64_t* dst, const uint64_t* src, size_t words)
+		{
+			size_t i = 0;
+			for (; i + 8 <= words; i += 8)
+			{
+				__m512i d = _mm512_loadu_si512((const void*)(dst + i));
+				__m512i s = _mm512_loadu_si512((const void*)(src + i));
+				_mm512_storeu_si512((void*)(dst + i), _mm512_and_si512(d, s));
+			}
+			for (; i < words; i++)
+				dst[i] &= src[i];
+		}
+
+		__attribute__((target("avx512f")))
+		inline void AndNotAvx512(uint64_t* dst, const uint64_t* src, size_t words)
+		{
+			size_t i = 0;
+			for (; i + 8 <= words; i += 8)
+			{
+				__m512i d = _mm512_loadu_si512((const void*)(dst + i));
+				__m512i s = _mm512_loadu_si512((const void*)(src + i));
+				_mm512_storeu_si512((void*)(dst + i), _mm512_andnot_si512(s, d));
+			}
+			for (; i < words; i++)
+				dst[i] &= ~src[i];
+		}
+#endif
+
+		inline void Select(RowOperation &and_op, RowOperation &and_not_op)
+		{
+			and_op = And;
+			and_not_op = AndNot;
+#ifdef BIT_STATE_X86
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f"))
+			{
+				and_op = AndAvx512;
+				and_not_op = AndNotAvx512;
+			}
+			else if (__builtin_cpu_supports("avx2"))
+			{
+				and_op = AndAvx2;
+				and_not_op = AndNotAvx2;
+			}
+#endif
+		}
+
+		//Index of the lowest set bit of a non zero word
+		inline uint32_t LowestBit(uint64_t word)
+		{
+#if defined(_MSC_VER) && defined(_M_X64)
+			unsigned long index;
+			_BitScanForward64(&index, word);
+			return (uint32_t)index;
+#elif defined(__GNUC__)
+			return (uint32_t)__builtin_ctzll(word);
+#else
+			uint32_t index = 0;
+			while (!(word & 1))
+			{
+				word >>= 1;
+				index++;
+			}
+			return index;
+#endif
+		}
+	}
+
+	/*----------------------------------------------------------
+	 * @class VF3BitSubState
+	 * @brief A state of the SSR keeping the target as bitsets
+	 * @details The adjacency rows of the target, the nodes of each class
+	 * and the unmapped nodes are bitsets. The candidates of the next
+	 * pattern node are its class, minus the mapped nodes, ANDed with the
+	 * adjacency rows of the images of its neighbors already mapped; for
+	 * the node-induced problem the rows of the images of the other mapped
+	 * nodes are removed too. Feasibility is left with the node and edge
+	 * attributes only. There is no look-ahead, as in VF3L.
+	 * The candidate buffers are shared by the states of a search, so
+	 * the state can't be used by the parallel engines.
+	 ---------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor = EqualityComparator<Node1, Node2>,
+		typename EdgeComparisonFunctor = EqualityComparator<Edge1, Edge2> >
+		class VF3BitSubState : public State
+	{
+	private:
+		//Earlier node of the order whose image constrains the candidates
+		struct Constraint
+		{
+			nodeID_t node;
+			bool out;		//TRUE for the row of the out edges of the image, FALSE for the in edges
+			bool edge;		//TRUE to keep the nodes in the row, FALSE to remove them
+		};
+
+		//Structures shared by all the states of a search
+		struct Bitsets
+		{
+			size_t words;						//Words of a row
+			std::vector<uint64_t> out_rows;		//Out neighbors of each target node
+			std::vector<uint64_t> in_rows;		//In neighbors of each target node, empty if the target is symmetric
+			std::vector<uint64_t> class_rows;	//Target nodes of each class
+			std::vector<uint64_t> unmapped;		//Target nodes not in the core set
+			std::vector<uint64_t> candidates;	//Candidates at each depth
+			std::vector<uint32_t> first;		//First constraint of the node at each depth
+			std::vector<Constraint> constraints;
+			bitrows::RowOperation and_op, and_not_op;
+		};
+
+		//Comparison functors for nodes and edges
+		NodeComparisonFunctor nf;
+		EdgeComparisonFunctor ef;
+
+		//Graphs to analyze
+		ARGraph<Node1, Edge1> *g1;
+		ARGraph<Node2, Edge2> *g2;
+
+		/* Structures for classes */
+		uint32_t *class_1;       //Classes for nodes of the first graph
+		uint32_t *class_2;       //Classes for nodes of the second graph
+		uint32_t classes_count;  //Number of classes
+
+		std::shared_ptr<Bitsets> bits;
+		const NeighborSignatures *signatures;  //Neighbor classes of the nodes, NULL if not used
+
+		//PRIVATE METHODS
+		void BackTrack();
+		void ComputeCandidates(nodeID_t node);
+		template<typename Node, typename Edge>
+		static bool IsSymmetric(ARGraph<Node, Edge> *g);
+
+	public:
+		VF3BitSubState(ARGraph<Node1, Edge1> *g1, ARGraph<Node2, Edge2> *g2,
+			uint32_t* class_1, uint32_t* class_2, uint32_t nclass,
+			nodeID_t* order = NULL, bool edgeInduced = false);
+		VF3BitSubState(const VF3BitSubState &state);
+		~VF3BitSubState();
+		static size_t RowBytes(ARGraph<Node2, Edge2> *g2);
+		inline ARGraph<Node1, Edge1> *GetGraph1() const { return g1; }
+		inline ARGraph<Node2, Edge2> *GetGraph2() const { return g2; }
+		//The signatures are shared by all the states and must outlive them
+		inline void SetNeighborSignatures(const NeighborSignatures *s) { signatures = s; }
+		bool NextPair(nodeID_t *pn1, nodeID_t *pn2,
+			nodeID_t prev_n1 = NULL_NODE, nodeID_t prev_n2 = NULL_NODE);
+		bool IsFeasiblePair(nodeID_t n1, nodeID_t n2);
+		void AddPair(nodeID_t n1, nodeID_t n2);
+		inline bool IsGoal() const { return core_len == n1; };
+		inline bool IsDead() const { return false; };
+	};
+
+	/*----------------------------------------------------------
+	 * VF3BitSubState::IsSymmetric(g)
+	 * Checks if every edge of a graph has its reverse.
+	 ---------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		template<typename Node, typename Edge>
+		bool VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::IsSymmetric(ARGraph<Node, Edge> *g)
+	{
+		for (nodeID_t n = 0; n < g->NodeCount(); n++)
+		{
+			uint32_t count = g->OutEdgeCount(n);
+			if (count != g->InEdgeCount(n) ||
+				memcmp(g->GetOutEdgeSet(n), g->GetInEdgeSet(n), count * sizeof(nodeID_t)))
+				return false;
+		}
+		return true;
+	}
+
+	/*----------------------------------------------------------
+	 * VF3BitSubState::RowBytes(g2)
+	 * Memory taken by the adjacency rows of a target: a row of
+	 * n2 bits for each node, twice if the target is not symmetric.
+	 ---------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		size_t VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::RowBytes(ARGraph<Node2, Edge2> *g2)
+	{
+		size_t words = ((size_t)g2->NodeCount() + 63) / 64;
+		size_t bytes = g2->NodeCount() * words * sizeof(uint64_t);
+		return IsSymmetric(g2) ? bytes : 2 * bytes;
+	}
+
+	/*----------------------------------------------------------
+	 * VF3BitSubState::VF3BitSubState(g1, g2)
+	 * Constructor. Makes an empty state and the bitsets.
+	 ---------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::VF3BitSubState(ARGraph<Node1, Edge1> *ag1, ARGraph<Node2, Edge2> *ag2,
+				uint32_t* class_1, uint32_t* class_2, uint32_t nclass, nodeID_t* order, bool edgeInduced)
+				:State(ag1->NodeCount(), ag2->NodeCount(), order, edgeInduced)
+	{
+		assert(class_1 != NULL && class_2 != NULL);
+		assert(order != NULL);
+
+		g1 = ag1;
+		g2 = ag2;
+		this->class_1 = class_1;
+		this->class_2 = class_2;
+		this->classes_count = nclass;
+		signatures = NULL;
+
+		if (n2 > BIT_STATE_MAX_NODES)
+			error("Target too large for the bitset state: %u nodes, at most %u", n2, BIT_STATE_MAX_NODES);
+
+		bits = std::make_shared<Bitsets>();
+		Bitsets &b = *bits;
+		size_t words = b.words = ((size_t)n2 + 63) / 64;
+		uint32_t i, j;
+		nodeID_t v, w;
+
+		bitrows::Select(b.and_op, b.and_not_op);
+
+		b.out_rows.assign(n2 * words, 0);
+		for (v = 0; v < n2; v++)
+			for (i = 0; i < g2->OutEdgeCount(v); i++)
+			{
+				w = g2->GetOutEdge(v, i);
+				b.out_rows[v * words + (w >> 6)] |= (uint64_t)1 << (w & 63);
+			}
+		bool symmetric = IsSymmetric(g2);
+		if (!symmetric)
+		{
+			b.in_rows.assign(n2 * words, 0);
+			for (v = 0; v < n2; v++)
+				for (i = 0; i < g2->InEdgeCount(v); i++)
+				{
+					w = g2->GetInEdge(v, i);
+					b.in_rows[v * words + (w >> 6)] |= (uint64_t)1 << (w & 63);
+				}
+		}
+
+		b.class_rows.assign((size_t)classes_count * words, 0);
+		for (v = 0; v < n2; v++)
+			b.class_rows[class_2[v] * words + (v >> 6)] |= (uint64_t)1 << (v & 63);
+
+		b.unmapped.assign(words, 0);
+		for (v = 0; v < n2; v++)
+			b.unmapped[v >> 6] |= (uint64_t)1 << (v & 63);
+		b.candidates.assign((size_t)n1 * words, 0);
+
+		//Constraints of each depth: the rows to keep first, then the ones
+		//to remove. With both graphs symmetric the in rows add nothing.
+		bool both_directions = !symmetric || !IsSymmetric(g1);
+		b.first.resize(n1 + 1);
+		for (i = 0; i < n1; i++)
+		{
+			nodeID_t u = order[i];
+			b.first[i] = (uint32_t)b.constraints.size();
+			for (int keep = 1; keep >= 0; keep--)
+			{
+				for (j = 0; j < i; j++)
+				{
+					nodeID_t p = order[j];
+					Constraint out_c = { p, true, g1->HasEdge(p, u) };
+					Constraint in_c = { p, false, g1->HasEdge(u, p) };
+					if (out_c.edge == (keep == 1) && (keep || !edgeInduced))
+						b.constraints.push_back(out_c);
+					if (both_directions && in_c.edge == (keep == 1) && (keep || !edgeInduced))
+						b.constraints.push_back(in_c);
+				}
+			}
+		}
+		b.first[n1] = (uint32_t)b.constraints.size();
+	}
+
+	/*----------------------------------------------------------
+	 * VF3BitSubState::VF3BitSubState(state)
+	 * Copy constructor.
+	 ---------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::VF3BitSubState(const VF3BitSubState &state):State(state)
+	{
+		g1 = state.g1;
+		g2 = state.g2;
+		class_1 = state.class_1;
+		class_2 = state.class_2;
+		classes_count = state.classes_count;
+		bits = state.bits;
+		signatures = state.signatures;
+	}
+
+	/*---------------------------------------------------------------
+	 * VF3BitSubState::~VF3BitSubState()
+	 * Destructor.
+	 --------------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>::~VF3BitSubState()
+	{
+		if (-- *share_count > 0)
+			BackTrack();
+	}
+
+	/*---------------------------------------------------------------
+	 * void VF3BitSubState::ComputeCandidates(node)
+	 * Fills the candidates of the current depth.
+	 --------------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		void VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::ComputeCandidates(nodeID_t node)
+	{
+		Bitsets &b = *bits;
+		size_t words = b.words;
+		uint64_t *cand = &b.candidates[core_len * words];
+		const uint64_t *in_rows = b.in_rows.empty() ? b.out_rows.data() : b.in_rows.data();
+
+		memcpy(cand, &b.class_rows[class_1[node] * words], words * sizeof(uint64_t));
+		b.and_op(cand, b.unmapped.data(), words);
+		for (uint32_t k = b.first[core_len]; k < b.first[core_len + 1]; k++)
+		{
+			const Constraint &cons = b.constraints[k];
+			const uint64_t *row = (cons.out ? b.out_rows.data() : in_rows) + core_1[cons.node] * words;
+			if (cons.edge)
+				b.and_op(cand, row, words);
+			else
+				b.and_not_op(cand, row, words);
+		}
+	}
+
+	/*--------------------------------------------------------------------------
+	 * bool VF3BitSubState::NextPair(pn1, pn2, prev_n1, prev_n2)
+	 * Puts in *pn1, *pn2 the next pair of nodes to be tried.
+	 * prev_n1 and prev_n2 must be the last nodes, or NULL_NODE (default)
+	 * to start from the first pair.
+	 * Returns false if no more pairs are available.
+	 -------------------------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		bool VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::NextPair(nodeID_t *pn1, nodeID_t *pn2, nodeID_t prev_n1, nodeID_t prev_n2)
+	{
+		nodeID_t curr_n1 = order[core_len];
+		size_t words = bits->words;
+		const uint64_t *cand = &bits->candidates[core_len * words];
+		size_t w;
+		uint64_t word;
+
+		if (prev_n2 == NULL_NODE)
+		{
+			ComputeCandidates(curr_n1);
+			w = 0;
+			word = words ? cand[0] : 0;
+		}
+		else
+		{
+			nodeID_t next = prev_n2 + 1;
+			w = next >> 6;
+			if (w >= words)
+				return false;
+			word = cand[w] & (~(uint64_t)0 << (next & 63));
+		}
+
+		while (!word)
+		{
+			if (++w >= words)
+				return false;
+			word = cand[w];
+		}
+
+		*pn1 = curr_n1;
+		*pn2 = (nodeID_t)(w * 64 + bitrows::LowestBit(word));
+		return true;
+	}
+
+	/*---------------------------------------------------------------
+	 * bool VF3BitSubState::IsFeasiblePair(node1, node2)
+	 * Returns true if (node1, node2) can be added to the state.
+	 * The edges with the core set are already guaranteed by the
+	 * candidates, only the attributes and the self loops are checked.
+	 --------------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		bool VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::IsFeasiblePair(nodeID_t node1, nodeID_t node2)
+	{
+		assert(node1 < n1);
+		assert(node2 < n2);
+		assert(core_1[node1] == NULL_NODE);
+		assert(core_2[node2] == NULL_NODE);
+
+		if (!nf(g1->GetNodeAttr(node1), g2->GetNodeAttr(node2)))
+			return false;
+
+		if (g1->InEdgeCount(node1) > g2->InEdgeCount(node2)
+			|| g1->OutEdgeCount(node1) > g2->OutEdgeCount(node2))
+			return false;
+
+		if (signatures && !signatures->Compatible(node1, node2))
+			return false;
+
+		Edge1 eattr1;
+		Edge2 eattr2;
+		bool loop1 = g1->HasEdge(node1, node1, eattr1);
+		bool loop2 = g2->HasEdge(node2, node2, eattr2);
+		if ((loop1 && (!loop2 || !CompatibleEdges(ef, eattr1, eattr2))) || (loop2 && !loop1 && !edgeInduced))
+			return false;
+
+		if (EdgeAttrTraits<Edge1>::stored || EdgeAttrTraits<Edge2>::stored)
+		{
+			uint32_t i;
+			nodeID_t other1;
+			for (i = 0; i < g1->OutEdgeCount(node1); i++)
+			{
+				other1 = g1->GetOutEdge(node1, i, eattr1);
+				if (other1 != node1 && core_1[other1] != NULL_NODE &&
+					(!g2->HasEdge(node2, core_1[other1], eattr2) || !CompatibleEdges(ef, eattr1, eattr2)))
+					return false;
+			}
+			for (i = 0; i < g1->InEdgeCount(node1); i++)
+			{
+				other1 = g1->GetInEdge(node1, i, eattr1);
+				if (other1 != node1 && core_1[other1] != NULL_NODE &&
+					(!g2->HasEdge(core_1[other1], node2, eattr2) || !CompatibleEdges(ef, eattr1, eattr2)))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	/*--------------------------------------------------------------
+	 * void VF3BitSubState::AddPair(node1, node2)
+	 * Adds a pair to the Core set of the state.
+	 * Precondition: the pair must be feasible
+	 -------------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		void VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
+			::AddPair(nodeID_t node1, nodeID_t node2)
+	{
+		assert(node1 < n1);
+		assert(node2 < n2);
+		assert(core_len < n1);
+		assert(core_len < n2);
+
+		core_len++;
+		added_node1 = node1;
+		core_1[node1] = node2;
+		core_2[node2] = node1;
+		bits->unmapped[node2 >> 6] &= ~((uint64_t)1 << (node2 & 63));
+	}
+
+	/*----------------------------------------------------------------
+	 * Undoes the changes to the shared vectors made by the
+	 * current state. Assumes that at most one AddPair has been
+	 * performed.
+	 ----------------------------------------------------------------*/
+	template <typename Node1, typename Node2,
+		typename Edge1, typename Edge2,
+		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
+		void VF3BitSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>::BackTrack()
+	{
+		assert(core_len - orig_core_len <= 1);
+		if (added_node1 != NULL_NODE && orig_core_len < core_len)
+		{
+			nodeID_t node2 = core_1[added_node1];
+			core_1[added_node1] = NULL_NODE;
+			core_2[node2] = NULL_NODE;
+			bits->unmapped[node2 >> 6] |= (uint64_t)1 << (node2 & 63);
+			core_len = orig_core_len;
+			added_node1 = NULL_NODE;
+		}
+	}
+
+}
+
+#endif
@@ -14,6 +14,8 @@
 #include <iostream>
 #include <vector>
 #include <ARGraph.hpp>
+#include <LevelClassTables.hpp>
+#include <ClassCountKernels.hpp>
 #include <VF3State.hpp>
 #include <State.hpp>
 
@@ -54,21 +56,18 @@ namespace vflib
 		//BE AWARE: Core nodes are also counted by these
 		//GLOBAL SIZE
 		uint32_t t2in_len, t2both_len, t2out_len; //Len of Terminal set for the second graph
-		uint32_t *t1in_len, *t1both_len, *t1out_len; //Len of Terminal set for the first graph for each level
 												//SIZE FOR EACH CLASS
 		uint32_t *t2both_len_c, *t2in_len_c, *t2out_len_c;     //Len of Terminal set for the second graph for each class
-		uint32_t **t1both_len_c, **t1in_len_c, **t1out_len_c;  //Len of Terminal set for the first graph for each class end level
 
 		//Used for terminal set size evaluation
 		uint32_t *termout2_c, *termin2_c, *new2_c;
-		uint32_t **termout1_c, **termin1_c, **new1_c;
-		uint32_t *termin1, *termout1, *new1;
+		std::vector<uint32_t> *touched2_c;  //Classes counted by the last feasibility check, to be cleared
 
-		//Terminal sets of the second graph
-		//TERM IN
-		nodeID_t *in_2;
-		//TERMI OUT
-		nodeID_t *out_2;
+		//Terminal set sizes of the first graph for each level up to the limit, overall and for each class
+		LevelClassTables *levels;
+
+		//Core and terminal sets of the second graph, with the classes of its nodes
+		TargetNodeRecord *records;
 
 		//Vector of sets used for searching the successors
 		//Each class has its set
@@ -88,7 +87,7 @@ namespace vflib
 		static long long instance_count;
 		VF3KSubState(ARGraph<Node1, Edge1> *g1, ARGraph<Node2, Edge2> *g2,
 			uint32_t* class_1, uint32_t* class_2, uint32_t nclass, uint32_t k=0,
-			nodeID_t* order = NULL, bool induced = true);
+			nodeID_t* order = NULL, bool edgeInduced = false, TargetWorkspace *workspace = NULL);
 		VF3KSubState(const VF3KSubState &state);
 		~VF3KSubState();
 		inline ARGraph<Node1, Edge1> *GetGraph1() const { return g1; }
@@ -110,8 +109,9 @@ namespace vflib
 		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
 		VF3KSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
 		::VF3KSubState(ARGraph<Node1, Edge1> *ag1, ARGraph<Node2, Edge2> *ag2,
-			uint32_t* class_1, uint32_t* class_2, uint32_t nclass, uint32_t k, nodeID_t* order, bool induced)
-		:State(ag1->NodeCount(), ag2->NodeCount(), order, induced)
+			uint32_t* class_1, uint32_t* class_2, uint32_t nclass, uint32_t k, nodeID_t* order, bool edgeInduced,
+			TargetWorkspace *workspace)
+		:State(ag1->NodeCount(), ag2->NodeCount(), order, edgeInduced, class_2, workspace)
 	{
 		assert(class_1 != NULL && class_2 != NULL);
 
@@ -132,60 +132,26 @@ namespace vflib
 		this->class_1 = class_1;
 		this->class_2 = class_2;
 		classes_count = nclass;
+		records = this->workspace->Records();
 		t2both_len = t2in_len = t2out_len = 0;
 
 		dir = new nodeDir_t[n1];
 		predecessors = new nodeID_t[n1];
-		core_len_c = new uint32_t[classes_count];
+		core_len_c = new uint32_t[classes_count]();
 
 		//Creating VF Sets
 		//Only if limit_level > 0
 		if(limit_level > 0)
 		{
-			t1both_len = new uint32_t[limit_level + 1];
-			t1in_len = new uint32_t[limit_level + 1];
-			t1out_len = new uint32_t[limit_level + 1];
-
-			termin1 = new uint32_t[limit_level];
-			termout1 = new uint32_t[limit_level];
-			new1 = new uint32_t[limit_level];
-
-			t1both_len_c = (uint32_t**)malloc((limit_level + 1) * sizeof(uint32_t*));
-			t1in_len_c = (uint32_t**)malloc((limit_level + 1) * sizeof(uint32_t*));
-			t1out_len_c = (uint32_t**)malloc((limit_level + 1) * sizeof(uint32_t*));
+			levels = new LevelClassTables(limit_level + 1, classes_count);
 
-			termin1_c = (uint32_t**)malloc(limit_level * sizeof(uint32_t*));
-			termout1_c = (uint32_t**)malloc(limit_level * sizeof(uint32_t*));
-			new1_c = (uint32_t**)malloc(limit_level * sizeof(uint32_t*));
-
-			t2both_len_c = new uint32_t[classes_count];
-			t2in_len_c = new uint32_t[classes_count];
-			t2out_len_c = new uint32_t[classes_count];
+			t2both_len_c = new uint32_t[classes_count]();
+			t2in_len_c = new uint32_t[classes_count]();
+			t2out_len_c = new uint32_t[classes_count]();
 			termout2_c = new uint32_t[classes_count];
 			termin2_c = new uint32_t[classes_count];
-			new2_c = new uint32_t[classes_count];
-
-			in_2 = new nodeID_t[n2];
-			out_2 = new nodeID_t[n2];
-
-			uint32_t i;
-			for (i = 0; i <= limit_level; i++)
-			{
-				if (i < limit_level) {
-					termin1_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-					termout1_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-					new1_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-				}
-				t1both_len_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-				t1in_len_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-				t1out_len_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-			}
-
-			for (i = 0; i < n2; i++)
-			{
-				in_2[i] = 0;
-				out_2[i] = 0;
-			}
+			new2_c = new uint32_t[classes_count]();
+			touched2_c = new std::vector<uint32_t>();
 		}
 		ComputeFirstGraphTraversing();
 	}
@@ -214,38 +180,24 @@ namespace vflib
 		dir = state.dir;
 		predecessors = state.predecessors;
 		core_len_c = state.core_len_c;
+		records = state.records;
 
 		if(limit_level>0)
 		{
-			t1in_len = state.t1in_len;
-			t1out_len = state.t1out_len;
-			t1both_len = state.t1both_len;
+			levels = state.levels;
 
 			t2in_len = state.t2in_len;
 			t2out_len = state.t2out_len;
 			t2both_len = state.t2both_len;
 
-
-			t1both_len_c = state.t1both_len_c;
 			t2both_len_c = state.t2both_len_c;
-			t1in_len_c = state.t1in_len_c;
 			t2in_len_c = state.t2in_len_c;
-			t1out_len_c = state.t1out_len_c;
 			t2out_len_c = state.t2out_len_c;
 
-			termout1_c = state.termout1_c;
 			termout2_c = state.termout2_c;
-			termin1_c = state.termin1_c;
 			termin2_c = state.termin2_c;
-			new1_c = state.new1_c;
 			new2_c = state.new2_c;
-
-			termin1 = state.termin1;
-			termout1 = state.termout1;
-			new1 = state.new1;
-
-			in_2 = state.in_2;
-			out_2 = state.out_2;
+			touched2_c = state.touched2_c;
 		}
 
 	}
@@ -272,37 +224,14 @@ namespace vflib
 
 			if(limit_level>0)
 			{
-				delete[] in_2;
-				delete[] out_2;
-				delete[] t1both_len;
-				delete[] t1in_len;
-				delete[] t1out_len;
-				delete[] termin1;
-				delete[] termout1;
-				delete[] new1;
+				delete levels;
 				delete[] t2both_len_c;
 				delete[] t2in_len_c;
 				delete[] t2out_len_c;
 				delete[] termin2_c;
 				delete[] termout2_c;
 				delete[] new2_c;
-
-				for (uint32_t i = 0; i <= limit_level; i++) {
-					free(t1both_len_c[i]);
-					free(t1in_len_c[i]);
-					free(t1out_len_c[i]);
-					if (i < limit_level) {
-						free(termin1_c[i]);
-						free(termout1_c[i]);
-						free(new1_c[i]);
-					}
-				}
-				free(t1both_len_c);
-				free(t1in_len_c);
-				free(t1out_len_c);
-				free(termin1_c);
-				free(termout1_c);
-				free(new1_c);
+				delete touched2_c;
 			}
 		}
 	}
@@ -314,6 +243,12 @@ namespace vflib
 		EdgeComparisonFunctor>::UpdateTerminalSetSize(nodeID_t node, nodeID_t level, bool* in_1, bool* out_1, bool* inserted) {
 		nodeID_t i, neigh, c_neigh;
 		nodeID_t in1_count, out1_count;
+		uint32_t &termin1 = levels->Total(level, LevelClassTables::TERM_IN);
+		uint32_t &termout1 = levels->Total(level, LevelClassTables::TERM_OUT);
+		uint32_t &new1 = levels->Total(level, LevelClassTables::NEW);
+		uint32_t *termin1_c = levels->Classes(level, LevelClassTables::TERM_IN);
+		uint32_t *termout1_c = levels->Classes(level, LevelClassTables::TERM_OUT);
+		uint32_t *new1_c = levels->Classes(level, LevelClassTables::NEW);
 
 		//Updating Terminal set size count And degree
 		in1_count = g1->InEdgeCount(node);
@@ -329,16 +264,16 @@ namespace vflib
 			if (!inserted[neigh])
 			{
 				if (in_1[neigh]) {
-					termin1[level]++;
-					termin1_c[level][c_neigh]++;
+					termin1++;
+					termin1_c[c_neigh]++;
 				}
 				if (out_1[neigh]) {
-					termout1[level]++;
-					termout1_c[level][c_neigh]++;
+					termout1++;
+					termout1_c[c_neigh]++;
 				}
 				if (!in_1[neigh] && !out_1[neigh]) {
-					new1[level]++;
-					new1_c[level][c_neigh]++;
+					new1++;
+					new1_c[c_neigh]++;
 				}
 			}
 		}
@@ -352,16 +287,16 @@ namespace vflib
 			if (!inserted[neigh])
 			{
 				if (in_1[neigh]) {
-					termin1[level]++;
-					termin1_c[level][c_neigh]++;
+					termin1++;
+					termin1_c[c_neigh]++;
 				}
 				if (out_1[neigh]) {
-					termout1[level]++;
-					termout1_c[level][c_neigh]++;
+					termout1++;
+					termout1_c[c_neigh]++;
 				}
 				if (!in_1[neigh] && !out_1[neigh]) {
-					new1[level]++;
-					new1_c[level][c_neigh]++;
+					new1++;
+					new1_c[c_neigh]++;
 				}
 			}
 		}
@@ -389,14 +324,6 @@ namespace vflib
 		node = 0;
 		node_c = 0;
 
-
-		if(limit_level > 0)
-		{
-			t1in_len[0] = 0;
-			t1out_len[0] = 0;
-			t1both_len[0] = 0;
-		}
-
 		for (i = 0; i < n1; i++)
 		{
 			in[i] = false;
@@ -418,15 +345,12 @@ namespace vflib
 				UpdateTerminalSetSize(node, depth, in, out, inserted);
 
 				//Updating counters for next step
-				t1in_len[depth + 1] = t1in_len[depth];
-				t1out_len[depth + 1] = t1out_len[depth];
-				t1both_len[depth + 1] = t1both_len[depth];
-				for (uint32_t j = 0; j < classes_count; j++)
-				{
-					t1in_len_c[depth + 1][j] = t1in_len_c[depth][j];
-					t1out_len_c[depth + 1][j] = t1out_len_c[depth][j];
-					t1both_len_c[depth + 1][j] = t1both_len_c[depth][j];
-				}
+				levels->Total(depth + 1, LevelClassTables::T1_BOTH) = levels->Total(depth, LevelClassTables::T1_BOTH);
+				levels->Total(depth + 1, LevelClassTables::T1_IN) = levels->Total(depth, LevelClassTables::T1_IN);
+				levels->Total(depth + 1, LevelClassTables::T1_OUT) = levels->Total(depth, LevelClassTables::T1_OUT);
+				//The rows of the three tables are contiguous
+				memcpy(levels->Classes(depth + 1, LevelClassTables::T1_BOTH), levels->Classes(depth, LevelClassTables::T1_BOTH),
+					3 * classes_count * sizeof(uint32_t));
 				//Inserting the node
 				//Terminal set sizes depends on the depth
 				// < depth non sono nell'insieme
@@ -434,22 +358,22 @@ namespace vflib
 				if (!in[node])
 				{
 					in[node] = true;
-					t1in_len[depth + 1]++;
-					t1in_len_c[depth + 1][node_c]++;
+					levels->Total(depth + 1, LevelClassTables::T1_IN)++;
+					levels->Classes(depth + 1, LevelClassTables::T1_IN)[node_c]++;
 					if (out[node]) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][node_c]++;
+						levels->Total(depth + 1, LevelClassTables::T1_BOTH)++;
+						levels->Classes(depth + 1, LevelClassTables::T1_BOTH)[node_c]++;
 					}
 				}
 
 				if (!out[node])
 				{
 					out[node] = true;
-					t1out_len[depth + 1]++;
-					t1out_len_c[depth + 1][node_c]++;
+					levels->Total(depth + 1, LevelClassTables::T1_OUT)++;
+					levels->Classes(depth + 1, LevelClassTables::T1_OUT)[node_c]++;
 					if (in[node]) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][node_c]++;
+						levels->Total(depth + 1, LevelClassTables::T1_BOTH)++;
+						levels->Classes(depth + 1, LevelClassTables::T1_BOTH)[node_c]++;
 					}
 				}
 			}
@@ -465,8 +389,8 @@ namespace vflib
 					in[other] = true;
 					if(depth < limit_level)
 					{
-						t1in_len[depth + 1]++;
-						t1in_len_c[depth + 1][other_c]++;
+						levels->Total(depth + 1, LevelClassTables::T1_IN)++;
+						levels->Classes(depth + 1, LevelClassTables::T1_IN)[other_c]++;
 					}
 					if (!inserted[other])
 					{
@@ -477,8 +401,8 @@ namespace vflib
 						}
 					}
 					if (out[other] && (depth < limit_level)) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][other_c]++;
+						levels->Total(depth + 1, LevelClassTables::T1_BOTH)++;
+						levels->Classes(depth + 1, LevelClassTables::T1_BOTH)[other_c]++;
 					}
 				}
 			}
@@ -492,8 +416,8 @@ namespace vflib
 					out[other] = true;
 					if(depth < limit_level)
 					{
-						t1out_len[depth + 1]++;
-						t1out_len_c[depth + 1][other_c]++;
+						levels->Total(depth + 1, LevelClassTables::T1_OUT)++;
+						levels->Classes(depth + 1, LevelClassTables::T1_OUT)[other_c]++;
 					}
 					if (!inserted[other])
 					{
@@ -504,8 +428,8 @@ namespace vflib
 						}
 					}
 					if (in[other] && (depth < limit_level)) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][other_c]++;
+						levels->Total(depth + 1, LevelClassTables::T1_BOTH)++;
+						levels->Classes(depth + 1, LevelClassTables::T1_BOTH)[other_c]++;
 					}
 				}
 			}
@@ -514,6 +438,9 @@ namespace vflib
 		delete[] in;
 		delete[] out;
 		delete[] inserted;
+
+		if(limit_level > 0)
+			levels->BuildActiveClasses();
 	}
 
 	template <typename Node1, typename Node2,
@@ -552,7 +479,7 @@ namespace vflib
 				while (last_candidate_index < pred_set_size)
 				{
 					prev_n2 = g2->GetInEdge(pred_pair, last_candidate_index);
-					if (core_2[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
+					if (records[prev_n2].core != NULL_NODE || records[prev_n2].cls != c)
 						last_candidate_index++;
 					else
 						break;
@@ -566,7 +493,7 @@ namespace vflib
 				while (last_candidate_index < pred_set_size)
 				{
 					prev_n2 = g2->GetOutEdge(pred_pair, last_candidate_index);
-					if (core_2[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
+					if (records[prev_n2].core != NULL_NODE || records[prev_n2].cls != c)
 						last_candidate_index++;
 					else
 						break;
@@ -588,8 +515,8 @@ namespace vflib
 				prev_n2++;
 
 			while (prev_n2 < n2 &&
-				(core_2[prev_n2] != NULL_NODE
-					|| class_2[prev_n2] != c))
+				(records[prev_n2].core != NULL_NODE
+					|| records[prev_n2].cls != c))
 			{
 				prev_n2++;
 			}
@@ -629,7 +556,7 @@ namespace vflib
 		assert(node1 < n1);
 		assert(node2 < n2);
 		assert(core_1[node1] == NULL_NODE);
-		assert(core_2[node2] == NULL_NODE);
+		assert(records[node2].core == NULL_NODE);
 
 		if (!nf(g1->GetNodeAttr(node1), g2->GetNodeAttr(node2)))
 			return false;
@@ -644,9 +571,13 @@ namespace vflib
 		uint32_t termout2 = 0, termin2 = 0, new2 = 0;
 		if(core_len < limit_level)
 		{
-			memset(termin2_c, 0, classes_count * sizeof(uint32_t));
-			memset(termout2_c, 0, classes_count * sizeof(uint32_t));
-			memset(new2_c, 0, classes_count * sizeof(uint32_t));
+			//Only the classes counted by the last check are cleared
+			for (i = 0; i < touched2_c->size(); i++)
+			{
+				c_other = (*touched2_c)[i];
+				termin2_c[c_other] = termout2_c[c_other] = new2_c[c_other] = 0;
+			}
+			touched2_c->clear();
 		}
 
 		// Check the 'out' edges of node1
@@ -658,7 +589,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(node2, other2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -672,7 +603,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(other2, node2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -682,12 +613,12 @@ namespace vflib
 		for (i = 0; i < g2->OutEdgeCount(node2); i++)
 		{
 			other2 = g2->GetOutEdge(node2, i);
-			c_other = class_2[other2];
-			if (core_2[other2] != NULL_NODE)
+			c_other = records[other2].cls;
+			if (records[other2].core != NULL_NODE)
 			{
-				if(induced)
+				if(!edgeInduced)
 				{
-					other1 = core_2[other2];
+					other1 = records[other2].core;
 					if (!g1->HasEdge(node1, other1))
 						return false;
 				}
@@ -696,15 +627,17 @@ namespace vflib
 			{
 				if(core_len < limit_level)
 				{
-					if (in_2[other2]) {
+					if (!termin2_c[c_other] && !termout2_c[c_other] && !new2_c[c_other])
+						touched2_c->push_back(c_other);
+					if (records[other2].in) {
 						termin2++;
 						termin2_c[c_other]++;
 					}
-					if (out_2[other2]) {
+					if (records[other2].out) {
 						termout2++;
 						termout2_c[c_other]++;
 					}
-					if (!in_2[other2] && !out_2[other2]) {
+					if (!records[other2].in && !records[other2].out) {
 						new2++;
 						new2_c[c_other]++;
 					}
@@ -716,12 +649,12 @@ namespace vflib
 		for (i = 0; i < g2->InEdgeCount(node2); i++)
 		{
 			other2 = g2->GetInEdge(node2, i);
-			c_other = class_2[other2];
-			if (core_2[other2] != NULL_NODE)
+			c_other = records[other2].cls;
+			if (records[other2].core != NULL_NODE)
 			{
-				if(induced)
+				if(!edgeInduced)
 				{
-					other1 = core_2[other2];
+					other1 = records[other2].core;
 					if (!g1->HasEdge(other1, node1))
 						return false;
 				}
@@ -730,15 +663,17 @@ namespace vflib
 			{
 				if(core_len < limit_level)
 				{
-					if (in_2[other2]) {
+					if (!termin2_c[c_other] && !termout2_c[c_other] && !new2_c[c_other])
+						touched2_c->push_back(c_other);
+					if (records[other2].in) {
 						termin2++;
 						termin2_c[c_other]++;
 					}
-					if (out_2[other2]) {
+					if (records[other2].out) {
 						termout2++;
 						termout2_c[c_other]++;
 					}
-					if (!in_2[other2] && !out_2[other2]) {
+					if (!records[other2].in && !records[other2].out) {
 						new2++;
 						new2_c[c_other]++;
 					}
@@ -749,24 +684,19 @@ namespace vflib
 		//Look-ahead check
 		if(core_len < limit_level)
 		{
-			if (termin1[core_len] <= termin2 && termout1[core_len] <= termout2) {
-				for (i = 0; i < classes_count; i++) {
-					if (termin1_c[core_len][i] > termin2_c[i] ||
-						termout1_c[core_len][i] > termout2_c[i]) {
-						return false;
-					}
-				}
-			}
-			else return false;
-
-			if (new1[core_len] <= new2)
-			{
-				for (i = 0; i < classes_count; i++) {
-					if (new1_c[core_len][i] > new2_c[i])
-						return false;
-				}
-			}
-			else return false;
+			const uint32_t termin1 = levels->Total(core_len, LevelClassTables::TERM_IN);
+			const uint32_t termout1 = levels->Total(core_len, LevelClassTables::TERM_OUT);
+			const uint32_t new1 = levels->Total(core_len, LevelClassTables::NEW);
+			const uint32_t *termin1_c = levels->Classes(core_len, LevelClassTables::TERM_IN);
+			const uint32_t *termout1_c = levels->Classes(core_len, LevelClassTables::TERM_OUT);
+			const uint32_t *new1_c = levels->Classes(core_len, LevelClassTables::NEW);
+			if (termin1 > termin2 || termout1 > termout2)
+				return false;
+			if (!edgeInduced ? new1 > new2 : new1 + termin1 + termout1 > new2 + termin2 + termout2)
+				return false;
+			if (classcounts::AnyExceeds(termin1_c, termout1_c, new1_c, termin2_c, termout2_c, new2_c, classes_count,
+				levels->ActiveClasses(core_len), levels->ActiveCount(core_len), edgeInduced))
+				return false;
 		}
 
 		//std::cout << "\nIs Feasible: " << node1 << " " << node2;
@@ -796,7 +726,7 @@ namespace vflib
 		assert(node2 < n2);
 		assert(core_len < n1);
 		assert(core_len < n2);
-		assert(class_1[node1] == class_2[node2]);
+		assert(class_1[node1] == records[node2].cls);
 
 		//Updating the core length
 		core_len++;
@@ -806,30 +736,30 @@ namespace vflib
 
 		//Inserting nodes into the core set
 		core_1[node1] = node2;
-		core_2[node2] = node1;
+		records[node2].core = node1;
 
 
 		//Checking if node2 is not in T2_in
 		if(core_len < limit_level)
 		{
-			if (!in_2[node2])
+			if (!records[node2].in)
 			{
-				in_2[node2] = core_len;
+				records[node2].in = core_len;
 				t2in_len++;
 				t2in_len_c[node_c]++;
-				if (out_2[node2]) {
+				if (records[node2].out) {
 					t2both_len++;
 					t2both_len_c[node_c]++;
 				}
 			}
 
 			//Checking if node2 is not in T2_in
-			if (!out_2[node2])
+			if (!records[node2].out)
 			{
-				out_2[node2] = core_len;
+				records[node2].out = core_len;
 				t2out_len++;
 				t2out_len_c[node_c]++;
-				if (in_2[node2]) {
+				if (records[node2].in) {
 					t2both_len++;
 					t2both_len_c[node_c]++;
 				}
@@ -842,14 +772,14 @@ namespace vflib
 			for (i = 0; i < g2->InEdgeCount(node2); i++)
 			{
 				other = g2->GetInEdge(node2, i);
-				if (!in_2[other])
+				if (!records[other].in)
 				{
-					other_c = class_2[other];
-					in_2[other] = core_len;
+					other_c = records[other].cls;
+					records[other].in = core_len;
 					//in2_set[other_c].push_back(other);
 					t2in_len++;
 					t2in_len_c[other_c]++;
-					if (out_2[other]) {
+					if (records[other].out) {
 						t2both_len++;
 						t2both_len_c[other_c]++;
 					}
@@ -859,14 +789,14 @@ namespace vflib
 			for (i = 0; i < g2->OutEdgeCount(node2); i++)
 			{
 				other = g2->GetOutEdge(node2, i);
-				if (!out_2[other])
+				if (!records[other].out)
 				{
-					other_c = class_2[other];
-					out_2[other] = core_len;
+					other_c = records[other].cls;
+					records[other].out = core_len;
 					//out2_set[other_c].push_back(other);
 					t2out_len++;
 					t2out_len_c[other_c]++;
-					if (in_2[other]) {
+					if (records[other].in) {
 						t2both_len++;
 						t2both_len_c[other_c]++;
 					}
@@ -904,19 +834,19 @@ namespace vflib
 
 			if(core_len < limit_level)
 			{
-				if (in_2[node2] == core_len) {
-					in_2[node2] = 0;
+				if (records[node2].in == core_len) {
+					records[node2].in = 0;
 					//in2_set[node_c].erase(node2);
 					t2in_len_c[node_c]--;
-					if (out_2[node2])
+					if (records[node2].out)
 						t2both_len_c[node_c]--;
 				}
 
-				if (out_2[node2] == core_len) {
-					out_2[node2] = 0;
+				if (records[node2].out == core_len) {
+					records[node2].out = 0;
 					//out2_set[node_c].erase(node2);
 					t2out_len_c[node_c]--;
-					if (in_2[node2])
+					if (records[node2].in)
 						t2both_len_c[node_c]--;
 
 				}
@@ -925,12 +855,12 @@ namespace vflib
 				for (i = 0; i < g2->InEdgeCount(node2); i++)
 				{
 					uint32_t other = g2->GetInEdge(node2, i);
-					other_c = class_2[other];
-					if (in_2[other] == core_len) {
-						in_2[other] = 0;
+					other_c = records[other].cls;
+					if (records[other].in == core_len) {
+						records[other].in = 0;
 						//in2_set[other_c].erase(other);
 						t2in_len_c[other_c] --;
-						if (out_2[other])
+						if (records[other].out)
 							t2both_len_c[other_c]--;
 					}
 				}
@@ -938,19 +868,19 @@ namespace vflib
 				for (i = 0; i < g2->OutEdgeCount(node2); i++)
 				{
 					uint32_t other = g2->GetOutEdge(node2, i);
-					other_c = class_2[other];
-					if (out_2[other] == core_len) {
-						out_2[other] = 0;
+					other_c = records[other].cls;
+					if (records[other].out == core_len) {
+						records[other].out = 0;
 						//out2_set[other_c].erase(other);
 						t2out_len_c[other_c] --;
-						if (in_2[other])
+						if (records[other].in)
 							t2both_len_c[other_c]--;
 					}
 				}
 			}
 
 			core_1[added_node1] = NULL_NODE;
-			core_2[node2] = NULL_NODE;
+			records[node2].core = NULL_NODE;
 
 			core_len = orig_core_len;
 			core_len_c[node_c]--;
@@ -966,16 +896,20 @@ namespace vflib
 
 		if(core_len < limit_level)
 		{
-			if (t1both_len[core_len] > t2both_len ||
-				t1out_len[core_len] > t2out_len ||
-				t1in_len[core_len] > t2in_len) {
+			const uint32_t *t1both_len_c = levels->Classes(core_len, LevelClassTables::T1_BOTH);
+			const uint32_t *t1in_len_c = levels->Classes(core_len, LevelClassTables::T1_IN);
+			const uint32_t *t1out_len_c = levels->Classes(core_len, LevelClassTables::T1_OUT);
+
+			if (levels->Total(core_len, LevelClassTables::T1_BOTH) > t2both_len ||
+				levels->Total(core_len, LevelClassTables::T1_OUT) > t2out_len ||
+				levels->Total(core_len, LevelClassTables::T1_IN) > t2in_len) {
 				return true;
 			}
 
 			for (uint32_t c = 0; c < classes_count; c++) {
-				if (t1both_len_c[core_len][c] > t2both_len_c[c] ||
-					t1out_len_c[core_len][c] > t2out_len_c[c] ||
-					t1in_len_c[core_len][c] > t2in_len_c[c]) {
+				if (t1both_len_c[c] > t2both_len_c[c] ||
+					t1out_len_c[c] > t2out_len_c[c] ||
+					t1in_len_c[c] > t2in_len_c[c]) {
 					return true;
 				}
 			}
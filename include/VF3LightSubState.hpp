@@ -12,9 +12,14 @@
 #include <cstring>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include <ARGraph.hpp>
 #include <VF3State.hpp>
 #include <State.hpp>
+#include <CandidateDomains.hpp>
+#include <NeighborSignatures.hpp>
+#include <ClassNodeIndex.hpp>
+#include <NeighborIntersection.hpp>
 
 namespace vflib
 {
@@ -44,6 +49,7 @@ namespace vflib
 
 		nodeDir_t* dir;        //Node coming set. Direction into the terminal set.
 		nodeID_t* predecessors;  //Previous node in the ordered sequence connected to a node
+		TargetNodeRecord *records;  //Core set of the second graph, with the classes of its nodes
 
 		//Vector of sets used for searching the successors
 		//Each class has its set
@@ -53,6 +59,10 @@ namespace vflib
 		uint32_t *class_1;       //Classes for nodes of the first graph
 		uint32_t *class_2;       //Classes for nodes of the first graph
 		uint32_t classes_count;  //Number of classes
+		std::shared_ptr<const ClassNodeIndex> class_nodes;  //Nodes of the second graph by class
+		const CandidateDomains *domains;  //Candidates of the nodes of the first graph, NULL if not used
+		const NeighborSignatures *signatures;  //Neighbor classes of the nodes, NULL if not used
+		NeighborIntersection *intersection;  //Candidates from all the mapped neighbors, NULL if not used
 
 		//PRIVATE METHODS
 		void BackTrack();
@@ -62,17 +72,22 @@ namespace vflib
 		static long long instance_count;
 		VF3LightSubState(ARGraph<Node1, Edge1> *g1, ARGraph<Node2, Edge2> *g2,
 			uint32_t* class_1, uint32_t* class_2, uint32_t nclass,
-			nodeID_t* order = NULL, bool edgeInduced = false);
+			nodeID_t* order = NULL, bool edgeInduced = false, TargetWorkspace *workspace = NULL);
 		VF3LightSubState(const VF3LightSubState &state);
 		~VF3LightSubState();
 		inline ARGraph<Node1, Edge1> *GetGraph1() const { return g1; }
 		inline ARGraph<Node2, Edge2> *GetGraph2() const { return g2; }
+		//The domains are shared by all the states and must outlive them
+		inline void SetCandidateDomains(const CandidateDomains *d) { domains = d; }
+		inline void SetNeighborSignatures(const NeighborSignatures *s) { signatures = s; }
+		//The intersection must be built on the same order of the state
+		inline void SetNeighborIntersection(NeighborIntersection *i) { intersection = i; }
 		bool NextPair(nodeID_t *pn1, nodeID_t *pn2,
 			nodeID_t prev_n1 = NULL_NODE, nodeID_t prev_n2 = NULL_NODE);
 		bool IsFeasiblePair(nodeID_t n1, nodeID_t n2);
 		void AddPair(nodeID_t n1, nodeID_t n2);
 		inline bool IsGoal() const { return core_len == n1; };
-		inline bool IsDead() const { return false; };
+		inline bool IsDead() const { return domains && domains->HasEmptyDomain(); };
 	};
 
 
@@ -85,8 +100,9 @@ namespace vflib
 		typename NodeComparisonFunctor, typename EdgeComparisonFunctor>
 		VF3LightSubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
 			::VF3LightSubState(ARGraph<Node1, Edge1> *ag1, ARGraph<Node2, Edge2> *ag2, 
-					uint32_t* class_1, uint32_t* class_2, uint32_t nclass, nodeID_t* order, bool edgeInduced)
-					:State(ag1->NodeCount(), ag2->NodeCount(), order, edgeInduced)
+					uint32_t* class_1, uint32_t* class_2, uint32_t nclass, nodeID_t* order, bool edgeInduced,
+					TargetWorkspace *workspace)
+					:State(ag1->NodeCount(), ag2->NodeCount(), order, edgeInduced, class_2, workspace)
 	{
 		assert(class_1 != NULL && class_2 != NULL);
 
@@ -99,6 +115,11 @@ namespace vflib
 		this->class_1 = class_1;
 		this->class_2 = class_2;
 		this->classes_count = nclass;
+		class_nodes = this->workspace->ClassNodes();
+		records = this->workspace->Records();
+		domains = NULL;
+		signatures = NULL;
+		intersection = NULL;
 
 		core_len = orig_core_len = 0;
 
@@ -129,6 +150,11 @@ namespace vflib
 		class_1 = state.class_1;
 		class_2 = state.class_2;
 		classes_count = state.classes_count;
+		class_nodes = state.class_nodes;
+		records = state.records;
+		domains = state.domains;
+		signatures = state.signatures;
+		intersection = state.intersection;
 		parent = &state;
 		used = false;
 
@@ -277,6 +303,31 @@ namespace vflib
 		curr_n1 = order[core_len];
 		c = class_1[curr_n1];
 
+		if (intersection && intersection->ConstraintCount(curr_n1) > 1)
+		{
+			//Candidates adjacent to the images of all the mapped neighbors
+			if (prev_n2 == NULL_NODE)
+			{
+				intersection->Intersect(g2, curr_n1, core_len, core_1, class_2, c);
+				last_candidate_index = 0;
+			}
+			else
+				last_candidate_index++;
+
+			const std::vector<nodeID_t> &candidates = intersection->Candidates(core_len);
+			pred_set_size = (nodeID_t)candidates.size();
+			while (last_candidate_index < pred_set_size
+				&& (records[candidates[last_candidate_index]].core != NULL_NODE
+					|| (domains && !domains->Contains(curr_n1, candidates[last_candidate_index]))))
+				last_candidate_index++;
+
+			if (last_candidate_index >= pred_set_size)
+				return false;
+			*pn1 = curr_n1;
+			*pn2 = candidates[last_candidate_index];
+			return true;
+		}
+
 		if (predecessors[curr_n1] != NULL_NODE)
 		{
 			if (prev_n2 == NULL_NODE)
@@ -286,55 +337,72 @@ namespace vflib
 			}
 
 			pred_pair = core_1[predecessors[curr_n1]];
+			const nodeID_t *candidates = NULL;
 			switch (dir[curr_n1])
 			{
 			case NODE_DIR_IN:
-				pred_set_size = g2->InEdgeCount(pred_pair);
-
-				while (last_candidate_index < pred_set_size)
+				if (g2->HasClassIndex(class_2))
+					candidates = g2->GetInEdgesOfClass(pred_pair, c, pred_set_size);
+				else
 				{
-					prev_n2 = g2->GetInEdge(pred_pair, last_candidate_index);
-					if (core_2[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
-						last_candidate_index++;
-					else
-						break;
+					candidates = g2->GetInEdgeSet(pred_pair);
+					pred_set_size = g2->InEdgeCount(pred_pair);
 				}
-
 				break;
 
 			case NODE_DIR_OUT:
-				pred_set_size = g2->OutEdgeCount(pred_pair);
-
-				while (last_candidate_index < pred_set_size)
+				if (g2->HasClassIndex(class_2))
+					candidates = g2->GetOutEdgesOfClass(pred_pair, c, pred_set_size);
+				else
 				{
-					prev_n2 = g2->GetOutEdge(pred_pair, last_candidate_index);
-					if (core_2[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
-						last_candidate_index++;
-					else
-						break;
+					candidates = g2->GetOutEdgeSet(pred_pair);
+					pred_set_size = g2->OutEdgeCount(pred_pair);
 				}
-
 				break;
 			}
 
+			while (last_candidate_index < pred_set_size)
+			{
+				prev_n2 = candidates[last_candidate_index];
+				if (records[prev_n2].core != NULL_NODE || records[prev_n2].cls != c
+					|| (domains && !domains->Contains(curr_n1, prev_n2)))
+					last_candidate_index++;
+				else
+					break;
+			}
+
 			if (last_candidate_index >= pred_set_size)
 				return false;
 
 		}
 		else
 		{
-			//Recupero il nodo dell'esterno
+			//Without a predecessor only the candidates of the node, or
+			//else the nodes of its class, are scanned
+			const nodeID_t *candidates;
 			if (prev_n2 == NULL_NODE)
-				prev_n2 = 0;
+				last_candidate_index = 0;
 			else
-				prev_n2++;
+				last_candidate_index++;
 
-			while (prev_n2 < n2 &&
-				(core_2[prev_n2] != NULL_NODE
-					|| class_2[prev_n2] != c))
+			if (domains)
 			{
-				prev_n2++;
+				candidates = domains->Candidates(curr_n1);
+				pred_set_size = domains->Size(curr_n1);
 			}
+			else
+			{
+				candidates = class_nodes->Nodes(c);
+				pred_set_size = class_nodes->Size(c);
+			}
+
+			while (last_candidate_index < pred_set_size
+				&& records[candidates[last_candidate_index]].core != NULL_NODE)
+				last_candidate_index++;
+
+			if (last_candidate_index >= pred_set_size)
+				return false;
+			prev_n2 = candidates[last_candidate_index];
 		}
 		//std::cout<<curr_n1 << " " << prev_n2 << " \n";
 
@@ -371,7 +439,7 @@ namespace vflib
 		assert(node1 < n1);
 		assert(node2 < n2);
 		assert(core_1[node1] == NULL_NODE);
-		assert(core_2[node2] == NULL_NODE);
+		assert(records[node2].core == NULL_NODE);
 
 		if (!nf(g1->GetNodeAttr(node1), g2->GetNodeAttr(node2)))
 			return false;
@@ -380,6 +448,9 @@ namespace vflib
 			|| g1->OutEdgeCount(node1) > g2->OutEdgeCount(node2))
 			return false;
 
+		if (signatures && !signatures->Compatible(node1, node2))
+			return false;
+
 		uint32_t i, other1, other2, c_other;
 		Edge1 eattr1;
 		Edge2 eattr2;
@@ -393,7 +464,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(node2, other2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -407,7 +478,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(other2, node2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -419,10 +490,10 @@ namespace vflib
 			for (i = 0; i < g2->OutEdgeCount(node2); i++)
 			{
 				other2 = g2->GetOutEdge(node2, i);
-				c_other = class_2[other2];
-				if (core_2[other2] != NULL_NODE)
+				c_other = records[other2].cls;
+				if (records[other2].core != NULL_NODE)
 				{
-					other1 = core_2[other2];
+					other1 = records[other2].core;
 					if (!g1->HasEdge(node1, other1))
 						return false;
 				}
@@ -432,10 +503,10 @@ namespace vflib
 			for (i = 0; i < g2->InEdgeCount(node2); i++)
 			{
 				other2 = g2->GetInEdge(node2, i);
-				c_other = class_2[other2];
-				if (core_2[other2] != NULL_NODE)
+				c_other = records[other2].cls;
+				if (records[other2].core != NULL_NODE)
 				{
-					other1 = core_2[other2];
+					other1 = records[other2].core;
 					if (!g1->HasEdge(other1, node1))
 						return false;
 				}
@@ -469,7 +540,7 @@ namespace vflib
 		assert(node2 < n2);
 		assert(core_len < n1);
 		assert(core_len < n2);
-		assert(class_1[node1] == class_2[node2]);
+		assert(class_1[node1] == records[node2].cls);
 
 		//Updating the core length
 		core_len++;
@@ -479,7 +550,7 @@ namespace vflib
 
 		//Inserting nodes into the core set
 		core_1[node1] = node2;
-		core_2[node2] = node1;
+		records[node2].core = node1;
 
 	}
 
@@ -510,7 +581,7 @@ namespace vflib
 				node2 = core_1[added_node1];
 
 				core_1[added_node1] = NULL_NODE;
-				core_2[node2] = NULL_NODE;
+				records[node2].core = NULL_NODE;
 
 				core_len = orig_core_len;
 				core_len_c[node_c]--;
@@ -65,35 +65,125 @@ namespace vflib
 	*/
 	class CompareSortingNodeProbability {
 	public:
-		bool operator()(VF3SortingNode* n1, VF3SortingNode* n2)
+		bool operator()(const VF3SortingNode& n1, const VF3SortingNode& n2) const
 		{
-			if (n1->GetProbability() < n2->GetProbability()) return true;
-			if (n1->GetProbability() == n2->GetProbability() &&
-				n1->GetDegree() > n2->GetDegree()) return true;
+			if (n1.GetProbability() < n2.GetProbability()) return true;
+			if (n1.GetProbability() == n2.GetProbability() &&
+				n1.GetDegree() > n2.GetDegree()) return true;
 			return false;
 		}
 	};
 
 	//Node sorter class used to sort the pattern
 	//Complete Sorter used in VF3 - Use probability and degM connections
+	//The candidates are kept in an indexed heap, so that sorting takes
+	//O((n + e) log n): the node with the highest degM is picked first,
+	//ties are broken by probability, degree and then by the order the
+	//nodes became candidates.
 	template<typename Node, typename Edge,
 		typename Probability = UniformProbability<Node, Edge > >
 		class VF3NodeSorter : NodeSorter<Node, Edge>
 	{
 	private:
 		Probability* probability;
+		std::vector<VF3SortingNode> nodes;
+		std::vector<nodeID_t> heap;			//< Candidates not yet used, as a binary heap
+		std::vector<uint32_t> heap_pos;		//< Position of each node in the heap, NULL_NODE if not in the heap
+		std::vector<uint32_t> candidate_seq;	//< Order in which the nodes became candidates
+		uint32_t candidate_count;
 
-		void AddNodeToSortedSet(ARGraph<Node, Edge>* pattern, nodeID_t node, nodeID_t level,
-			std::vector<VF3SortingNode*>& nodes, std::vector<VF3SortingNode*> &candidates,
+		VF3NodeSorter(const VF3NodeSorter&);
+		VF3NodeSorter& operator=(const VF3NodeSorter&);
+
+		inline bool Precedes(nodeID_t a, nodeID_t b) const
+		{
+			if (nodes[a] < nodes[b])
+				return true;
+			if (nodes[b] < nodes[a])
+				return false;
+			return candidate_seq[a] < candidate_seq[b];
+		}
+
+		inline void PlaceInHeap(uint32_t pos, nodeID_t node)
+		{
+			heap[pos] = node;
+			heap_pos[node] = pos;
+		}
+
+		void SiftUp(uint32_t pos)
+		{
+			nodeID_t node = heap[pos];
+			while (pos > 0)
+			{
+				uint32_t parent = (pos - 1) >> 1;
+				if (!Precedes(node, heap[parent]))
+					break;
+				PlaceInHeap(pos, heap[parent]);
+				pos = parent;
+			}
+			PlaceInHeap(pos, node);
+		}
+
+		void SiftDown(uint32_t pos)
+		{
+			nodeID_t node = heap[pos];
+			uint32_t size = (uint32_t)heap.size();
+			for (;;)
+			{
+				uint32_t child = 2 * pos + 1;
+				if (child >= size)
+					break;
+				if (child + 1 < size && Precedes(heap[child + 1], heap[child]))
+					child++;
+				if (!Precedes(heap[child], node))
+					break;
+				PlaceInHeap(pos, heap[child]);
+				pos = child;
+			}
+			PlaceInHeap(pos, node);
+		}
+
+		nodeID_t PopCandidate()
+		{
+			nodeID_t top = heap[0];
+			nodeID_t last = heap.back();
+			heap.pop_back();
+			heap_pos[top] = NULL_NODE;
+			if (!heap.empty())
+			{
+				PlaceInHeap(0, last);
+				SiftDown(0);
+			}
+			return top;
+		}
+
+		void UpdateNeighbor(nodeID_t neigh)
+		{
+			VF3SortingNode& node = nodes[neigh];
+			if (!node.IsUsed())
+			{
+				node.IncreaseMatchingDegree();
+				if (heap_pos[neigh] != NULL_NODE)
+					SiftUp(heap_pos[neigh]);
+			}
+			if (!node.IsInCandidate()) {
+				node.SetInCanidate();
+				candidate_seq[neigh] = candidate_count++;
+				heap.push_back(neigh);
+				SiftUp((uint32_t)heap.size() - 1);
+			}
+		}
+
+		void AddNodeToSortedSet(ARGraph<Node, Edge>* pattern, nodeID_t node,
 			std::vector<nodeID_t> &nodes_order)
 		{
-			nodeID_t i, neigh;
+			nodeID_t i;
 			nodeID_t in1_count, out1_count;
 
 			nodes_order.push_back(node);
-			nodes[node]->SetUsed();
-			nodes[node]->SetInCanidate();
-			nodes[node]->ResetMatchingDegree();
+			nodes[node].SetUsed();
+			nodes[node].SetInCanidate();
+			nodes[node].ResetMatchingDegree();
 
 			//Updating Terminal set size count And degree
 			in1_count = pattern->InEdgeCount(node);
@@ -101,30 +191,11 @@ namespace vflib
 
 			//Updating Inner Nodes not yet inserted
 			for (i = 0; i < in1_count; i++)
-			{
-				//Getting Neighborhood
-				neigh = pattern->GetInEdge(node, i);
-				if (!nodes[neigh]->IsUsed())
-					nodes[neigh]->IncreaseMatchingDegree();
-				if (!nodes[neigh]->IsInCandidate()) {
-					nodes[neigh]->SetInCanidate();
-					candidates.push_back(nodes[neigh]);
-				}
-
-			}
+				UpdateNeighbor(pattern->GetInEdge(node, i));
 
 			//Updating Outer Nodes not yet insered
 			for (i = 0; i < out1_count; i++)
-			{
-				//Getting Neighborhood
-				neigh = pattern->GetOutEdge(node, i);
-				if (!nodes[neigh]->IsUsed())
-					nodes[neigh]->IncreaseMatchingDegree();
-				if (!nodes[neigh]->IsInCandidate()) {
-					nodes[neigh]->SetInCanidate();
-					candidates.push_back(nodes[neigh]);
-				}
-			}
+				UpdateNeighbor(pattern->GetOutEdge(node, i));
 		}
 
 	public:
@@ -133,6 +204,15 @@ namespace vflib
 			probability = new Probability(target);
 		}
 
+		/*
+		* @brief Builds the sorter on a precomputed profile of the target,
+		* that can be shared with other sorters.
+		*/
+		VF3NodeSorter(std::shared_ptr<const TargetProfile<Node, Edge> > target_profile)
+		{
+			probability = new Probability(target_profile);
+		}
+
 		~VF3NodeSorter()
 		{
 			delete probability;
@@ -141,42 +221,45 @@ namespace vflib
 		std::vector<nodeID_t> SortNodes(ARGraph<Node, Edge>* pattern)
 		{
 			uint32_t nodeCount;
-			uint32_t i;
+			uint32_t i, n;
+			nodeID_t top, next_unused;
 			nodeCount = pattern->NodeCount();
 			std::vector<nodeID_t> nodes_order; //Output vector with sorted nodes
-										  //We use two structures the fist used to quickly edit the deg_m of a node by its index
-										  //The second to perform a priority queue by means a max heap
-			std::vector<VF3SortingNode*> nodes(nodeCount);
-			std::vector<VF3SortingNode*> candidates; //Node candidate for the addition
-			std::vector<VF3SortingNode*>::iterator candidate_it;
-			std::vector<VF3SortingNode*>::iterator max_node;
-			//Initializing the node vector for sorting
+			if (!nodeCount)
+				return nodes_order;
+			nodes_order.reserve(nodeCount);
 
+			//Initializing the node vector for sorting
+			nodes.clear();
+			nodes.reserve(nodeCount);
 			for (i = 0; i < nodeCount; i++)
 			{
-				// std::cout << "Node: " << i << " - " << pattern->EdgeCount(i) << " - " << probability->GetProbability(pattern, i) << std::endl;
-				nodes[i] = new VF3SortingNode(i, pattern->EdgeCount(i), probability->GetProbability(pattern, i));
+				nodes.push_back(VF3SortingNode(i, pattern->EdgeCount(i), probability->GetProbability(pattern, i)));
 			}
+			heap.clear();
+			heap.reserve(nodeCount);
+			heap_pos.assign(nodeCount, NULL_NODE);
+			candidate_seq.assign(nodeCount, 0);
+			candidate_count = 0;
 
-			uint32_t n = 0;
-			candidate_it = std::min_element(nodes.begin(), nodes.end(), CompareSortingNodeProbability());
-			nodeID_t top = (*candidate_it)->GetID();
-			AddNodeToSortedSet(pattern, top, n, nodes, candidates, nodes_order);
-
-			//Getting the first node of the heap
-			for (; n < nodeCount - 1; n++) {
-				candidate_it = std::min_element(candidates.begin(), candidates.end(), CompareCandidates<VF3SortingNode>());
+			//The first node is the least probable one, then the one with the highest degree
+			top = (nodeID_t)(std::min_element(nodes.begin(), nodes.end(), CompareSortingNodeProbability()) - nodes.begin());
+			AddNodeToSortedSet(pattern, top, nodes_order);
 
-				//Searching for remaining user
-				if ((*candidate_it)->IsUsed())
+			//When no candidate is left the first unused node is taken
+			next_unused = 0;
+			for (n = 0; n < nodeCount - 1; n++) {
+				if (!heap.empty())
 				{
-					candidate_it = std::find_if(nodes.begin(), nodes.end(), FindUnused());
-					AddNodeToSortedSet(pattern, (*candidate_it)->GetID(), n, nodes, candidates, nodes_order);
+					top = PopCandidate();
 				}
-				else if (candidate_it != candidates.end())
+				else
 				{
-					AddNodeToSortedSet(pattern, (*candidate_it)->GetID(), n, nodes, candidates, nodes_order);
+					while (nodes[next_unused].IsUsed())
+						next_unused++;
+					top = next_unused;
 				}
+				AddNodeToSortedSet(pattern, top, nodes_order);
 			}
 
 			return nodes_order;
@@ -16,6 +16,7 @@
 
 #include <State.hpp>
 #include <ARGraph.hpp>
+#include <LevelClassTables.hpp>
 
 namespace vflib
 {
@@ -58,16 +59,14 @@ namespace vflib
 		//BE AWARE: Core nodes are also counted by these
 		//GLOBAL SIZE
 		uint32_t t2in_len, t2both_len, t2out_len; //Len of Terminal set for the second graph
-		uint32_t *t1in_len, *t1both_len, *t1out_len; //Len of Terminal set for the first graph for each level
 												//SIZE FOR EACH CLASS
 		uint32_t *t2both_len_c, *t2in_len_c, *t2out_len_c;     //Len of Terminal set for the second graph for each class
-		uint32_t **t1both_len_c, **t1in_len_c, **t1out_len_c;  //Len of Terminal set for the first graph for each class end level
 
 		//Used for terminal set size evaluation
 		uint32_t *termout2_c, *termin2_c, *new2_c;
-		uint32_t **termout1_c, **termin1_c, **new1_c;
 
-		uint32_t *termin1, *termout1, *new1;
+		//Terminal set sizes of the first graph for each level, overall and for each class
+		LevelClassTables *levels;
 
 		//Terminal sets of the second graph
 		//TERM IN
@@ -130,27 +129,12 @@ namespace vflib
 		t2both_len = t2in_len = t2out_len = 0;
 
 		//Creazione degli insiemi
-		t1both_len = new uint32_t[n1 + 1];
-		t1in_len = new uint32_t[n1 + 1];
-		t1out_len = new uint32_t[n1 + 1];
+		levels = new LevelClassTables(n1 + 1, classes_count);
 
-		termin1 = (uint32_t*)calloc(n1, sizeof(uint32_t));
-		termout1 = (uint32_t*)calloc(n1, sizeof(uint32_t));
-		new1 = (uint32_t*)calloc(n1, sizeof(uint32_t));
-
-		t1both_len_c = (uint32_t**)malloc((n1 + 1) * sizeof(uint32_t*));
-		t1in_len_c = (uint32_t**)malloc((n1 + 1) * sizeof(uint32_t*));
-		t1out_len_c = (uint32_t**)malloc((n1 + 1) * sizeof(uint32_t*));
-
-
-		termin1_c = (uint32_t**)malloc(n1 * sizeof(uint32_t*));
-		termout1_c = (uint32_t**)malloc(n1 * sizeof(uint32_t*));
-		new1_c = (uint32_t**)malloc(n1 * sizeof(uint32_t*));
-
-		core_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		t2both_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		t2in_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		t2out_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
+		core_len_c = new uint32_t[classes_count]();
+		t2both_len_c = new uint32_t[classes_count]();
+		t2in_len_c = new uint32_t[classes_count]();
+		t2out_len_c = new uint32_t[classes_count]();
 		termout2_c = new uint32_t[classes_count];
 		termin2_c = new uint32_t[classes_count];
 		new2_c = new uint32_t[classes_count];
@@ -160,20 +144,7 @@ namespace vflib
 		dir = new nodeDir_t[n1];
 		predecessors = new nodeID_t[n1];
 
-		uint32_t i;
-		for (i = 0; i <= n1; i++)
-		{
-			if (i < n1) {
-				termin1_c[i] = (int*)calloc(classes_count, sizeof(int));
-				termout1_c[i] = (int*)calloc(classes_count, sizeof(int));
-				new1_c[i] = (int*)calloc(classes_count, sizeof(int));
-			}
-			t1both_len_c[i] = (int*)calloc(classes_count, sizeof(int));
-			t1in_len_c[i] = (int*)calloc(classes_count, sizeof(int));
-			t1out_len_c[i] = (int*)calloc(classes_count, sizeof(int));
-		}
-
-		for (i = 0; i < n2; i++)
+		for (uint32_t i = 0; i < n2; i++)
 		{
 			in_2[i] = 0;
 			out_2[i] = 0;
@@ -201,33 +172,21 @@ namespace vflib
 		class_2 = state.class_2;
 		classes_count = state.classes_count;
 
-		t1in_len = state.t1in_len;
-		t1out_len = state.t1out_len;
-		t1both_len = state.t1both_len;
+		levels = state.levels;
 
 		t2in_len = state.t2in_len;
 		t2out_len = state.t2out_len;
 		t2both_len = state.t2both_len;
 
 		core_len_c = state.core_len_c;
-		t1both_len_c = state.t1both_len_c;
 		t2both_len_c = state.t2both_len_c;
-		t1in_len_c = state.t1in_len_c;
 		t2in_len_c = state.t2in_len_c;
-		t1out_len_c = state.t1out_len_c;
 		t2out_len_c = state.t2out_len_c;
 
-		termout1_c = state.termout1_c;
 		termout2_c = state.termout2_c;
-		termin1_c = state.termin1_c;
 		termin2_c = state.termin2_c;
-		new1_c = state.new1_c;
 		new2_c = state.new2_c;
 
-		termin1 = state.termin1;
-		termout1 = state.termout1;
-		new1 = state.new1;
-
 		in_2 = state.in_2;
 		out_2 = state.out_2;
 		dir = state.dir;
@@ -254,30 +213,7 @@ namespace vflib
 			delete[] out_2;
 			delete[] dir;
 			delete[] predecessors;
-			delete[] t1both_len;
-			delete[] t1in_len;
-			delete[] t1out_len;
-			delete[] termin1;
-			delete[] termout1;
-			delete[] new1;
-
-			for (uint32_t i = 0; i <= n1; i++) {
-				delete[] t1both_len_c[i];
-				delete[] t1in_len_c[i];
-				delete[] t1out_len_c[i];
-				if (i < n1) {
-					delete[] termin1_c[i];
-					delete[] termout1_c[i];
-					delete[] new1_c[i];
-				}
-			}
-
-			delete[] t1both_len_c;
-			delete[] t1in_len_c;
-			delete[] t1out_len_c;
-			delete[] termin1_c;
-			delete[] termout1_c;
-			delete[] new1_c;
+			delete levels;
 			delete[] t2both_len_c;
 			delete[] t2in_len_c;
 			delete[] t2out_len_c;
@@ -296,6 +232,12 @@ namespace vflib
 			bool* in_1, bool* out_1, bool* inserted) {
 		nodeID_t i, neigh, c_neigh;
 		nodeID_t in1_count, out1_count;
+		uint32_t &termin1 = levels->Total(level, LevelClassTables::TERM_IN);
+		uint32_t &termout1 = levels->Total(level, LevelClassTables::TERM_OUT);
+		uint32_t &new1 = levels->Total(level, LevelClassTables::NEW);
+		uint32_t *termin1_c = levels->Classes(level, LevelClassTables::TERM_IN);
+		uint32_t *termout1_c = levels->Classes(level, LevelClassTables::TERM_OUT);
+		uint32_t *new1_c = levels->Classes(level, LevelClassTables::NEW);
 
 		//Updating Terminal set size count And degree
 		in1_count = g1->InEdgeCount(node);
@@ -311,16 +253,16 @@ namespace vflib
 			if (!inserted[neigh])
 			{
 				if (in_1[neigh]) {
-					termin1[level]++;
-					termin1_c[level][c_neigh]++;
+					termin1++;
+					termin1_c[c_neigh]++;
 				}
 				if (out_1[neigh]) {
-					termout1[level]++;
-					termout1_c[level][c_neigh]++;
+					termout1++;
+					termout1_c[c_neigh]++;
 				}
 				if (!in_1[neigh] && !out_1[neigh]) {
-					new1[level]++;
-					new1_c[level][c_neigh]++;
+					new1++;
+					new1_c[c_neigh]++;
 				}
 			}
 		}
@@ -334,16 +276,16 @@ namespace vflib
 			if (!inserted[neigh])
 			{
 				if (in_1[neigh]) {
-					termin1[level]++;
-					termin1_c[level][c_neigh]++;
+					termin1++;
+					termin1_c[c_neigh]++;
 				}
 				if (out_1[neigh]) {
-					termout1[level]++;
-					termout1_c[level][c_neigh]++;
+					termout1++;
+					termout1_c[c_neigh]++;
 				}
 				if (!in_1[neigh] && !out_1[neigh]) {
-					new1[level]++;
-					new1_c[level][c_neigh]++;
+					new1++;
+					new1_c[c_neigh]++;
 				}
 			}
 		}
@@ -370,10 +312,6 @@ namespace vflib
 		node = 0;
 		node_c = 0;
 
-		t1in_len[0] = 0;
-		t1out_len[0] = 0;
-		t1both_len[0] = 0;
-
 		for (i = 0; i < n1; i++)
 		{
 			in[i] = false;
@@ -393,15 +331,18 @@ namespace vflib
 			UpdateTerminalSetSize(node, depth, in, out, inserted);
 
 			//Updating counters for next step
-			t1in_len[depth + 1] = t1in_len[depth];
-			t1out_len[depth + 1] = t1out_len[depth];
-			t1both_len[depth + 1] = t1both_len[depth];
-			for (uint32_t j = 0; j < classes_count; j++)
-			{
-				t1in_len_c[depth + 1][j] = t1in_len_c[depth][j];
-				t1out_len_c[depth + 1][j] = t1out_len_c[depth][j];
-				t1both_len_c[depth + 1][j] = t1both_len_c[depth][j];
-			}
+			uint32_t &t1both_len = levels->Total(depth + 1, LevelClassTables::T1_BOTH);
+			uint32_t &t1in_len = levels->Total(depth + 1, LevelClassTables::T1_IN);
+			uint32_t &t1out_len = levels->Total(depth + 1, LevelClassTables::T1_OUT);
+			uint32_t *t1both_len_c = levels->Classes(depth + 1, LevelClassTables::T1_BOTH);
+			uint32_t *t1in_len_c = levels->Classes(depth + 1, LevelClassTables::T1_IN);
+			uint32_t *t1out_len_c = levels->Classes(depth + 1, LevelClassTables::T1_OUT);
+			t1both_len = levels->Total(depth, LevelClassTables::T1_BOTH);
+			t1in_len = levels->Total(depth, LevelClassTables::T1_IN);
+			t1out_len = levels->Total(depth, LevelClassTables::T1_OUT);
+			//The rows of the three tables are contiguous
+			memcpy(t1both_len_c, levels->Classes(depth, LevelClassTables::T1_BOTH),
+				3 * classes_count * sizeof(uint32_t));
 			//Inserting the node
 			//Terminal set sizes depends on the depth
 			// < depth non sono nell'insieme
@@ -409,22 +350,22 @@ namespace vflib
 			if (!in[node])
 			{
 				in[node] = true;
-				t1in_len[depth + 1]++;
-				t1in_len_c[depth + 1][node_c]++;
+				t1in_len++;
+				t1in_len_c[node_c]++;
 				if (out[node]) {
-					t1both_len[depth + 1]++;
-					t1both_len_c[depth + 1][node_c]++;
+					t1both_len++;
+					t1both_len_c[node_c]++;
 				}
 			}
 
 			if (!out[node])
 			{
 				out[node] = true;
-				t1out_len[depth + 1]++;
-				t1out_len_c[depth + 1][node_c]++;
+				t1out_len++;
+				t1out_len_c[node_c]++;
 				if (in[node]) {
-					t1both_len[depth + 1]++;
-					t1both_len_c[depth + 1][node_c]++;
+					t1both_len++;
+					t1both_len_c[node_c]++;
 				}
 			}
 
@@ -438,8 +379,8 @@ namespace vflib
 				{
 					other_c = class_1[other];
 					in[other] = true;
-					t1in_len[depth + 1]++;
-					t1in_len_c[depth + 1][other_c]++;
+					t1in_len++;
+					t1in_len_c[other_c]++;
 					if (!inserted[other])
 					{
 						//dir[other] = NODE_DIR_IN;
@@ -450,8 +391,8 @@ namespace vflib
 						}
 					}
 					if (out[other]) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][other_c]++;
+						t1both_len++;
+						t1both_len_c[other_c]++;
 						//if(!inserted[other])
 						//dir[other] = NODE_DIR_BOTH;
 					}
@@ -465,8 +406,8 @@ namespace vflib
 				{
 					other_c = class_1[other];
 					out[other] = true;
-					t1out_len[depth + 1]++;
-					t1out_len_c[depth + 1][other_c]++;
+					t1out_len++;
+					t1out_len_c[other_c]++;
 					if (!inserted[other])
 					{
 						//dir[other] = NODE_DIR_OUT;
@@ -477,8 +418,8 @@ namespace vflib
 						}
 					}
 					if (in[other]) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][other_c]++;
+						t1both_len++;
+						t1both_len_c[other_c]++;
 						//if(!inserted[other])
 						//dir[other] = NODE_DIR_BOTH;
 					}
@@ -627,7 +568,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(node2, other2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -641,7 +582,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(other2, node2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -710,22 +651,28 @@ namespace vflib
 		}
 
 		//Look-ahead check
+		const uint32_t termin1 = levels->Total(core_len, LevelClassTables::TERM_IN);
+		const uint32_t termout1 = levels->Total(core_len, LevelClassTables::TERM_OUT);
+		const uint32_t new1 = levels->Total(core_len, LevelClassTables::NEW);
+		const uint32_t *termin1_c = levels->Classes(core_len, LevelClassTables::TERM_IN);
+		const uint32_t *termout1_c = levels->Classes(core_len, LevelClassTables::TERM_OUT);
+		const uint32_t *new1_c = levels->Classes(core_len, LevelClassTables::NEW);
 		if(!edgeInduced)
 		{
-			if (termin1[core_len] == termin2 && termout1[core_len] == termout2) {
+			if (termin1 == termin2 && termout1 == termout2) {
 				for (i = 0; i < classes_count; i++) {
-					if (termin1_c[core_len][i] != termin2_c[i] ||
-						termout1_c[core_len][i] != termout2_c[i]) {
+					if (termin1_c[i] != termin2_c[i] ||
+						termout1_c[i] != termout2_c[i]) {
 						return false;
 					}
 				}
 			}
 			else return false;
 
-			if (new1[core_len] == new2)
+			if (new1 == new2)
 			{
 				for (i = 0; i < classes_count; i++) {
-					if (new1_c[core_len][i] != new2_c[i])
+					if (new1_c[i] != new2_c[i])
 						return false;
 				}
 			}
@@ -733,20 +680,20 @@ namespace vflib
 		}
 		else
 		{
-			if (termin1[core_len] <= termin2 && termout1[core_len] <= termout2) {
+			if (termin1 <= termin2 && termout1 <= termout2) {
 				for (i = 0; i < classes_count; i++) {
-					if (termin1_c[core_len][i] > termin2_c[i] ||
-						termout1_c[core_len][i] > termout2_c[i]) {
+					if (termin1_c[i] > termin2_c[i] ||
+						termout1_c[i] > termout2_c[i]) {
 						return false;
 					}
 				}
 			}
 			else return false;
 
-			if (new1[core_len] <= new2)
+			if (new1 <= new2)
 			{
 				for (i = 0; i < classes_count; i++) {
-					if (new1_c[core_len][i] > new2_c[i])
+					if (new1_c[i] > new2_c[i])
 						return false;
 				}
 			}
@@ -939,16 +886,20 @@ namespace vflib
 			NodeComparisonFunctor, EdgeComparisonFunctor>::IsDead() const 
 	{
 
-		if (t1both_len[core_len] != t2both_len ||
-			t1out_len[core_len] != t2out_len ||
-			t1in_len[core_len] != t2in_len) {
+		const uint32_t *t1both_len_c = levels->Classes(core_len, LevelClassTables::T1_BOTH);
+		const uint32_t *t1in_len_c = levels->Classes(core_len, LevelClassTables::T1_IN);
+		const uint32_t *t1out_len_c = levels->Classes(core_len, LevelClassTables::T1_OUT);
+
+		if (levels->Total(core_len, LevelClassTables::T1_BOTH) != t2both_len ||
+			levels->Total(core_len, LevelClassTables::T1_OUT) != t2out_len ||
+			levels->Total(core_len, LevelClassTables::T1_IN) != t2in_len) {
 			return true;
 		}
 
 		for (int32_t c = 0; c < classes_count; c++) {
-			if (t1both_len_c[core_len][c] != t2both_len_c[c] ||
-				t1out_len_c[core_len][c] != t2out_len_c[c] ||
-				t1in_len_c[core_len][c] != t2in_len_c[c]) {
+			if (t1both_len_c[c] != t2both_len_c[c] ||
+				t1out_len_c[c] != t2out_len_c[c] ||
+				t1in_len_c[c] != t2in_len_c[c]) {
 				return true;
 			}
 		}
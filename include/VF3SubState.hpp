@@ -13,9 +13,16 @@
 #include <cstring>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include <ARGraph.hpp>
 #include <VF3State.hpp>
 #include <State.hpp>
+#include <CandidateDomains.hpp>
+#include <NeighborSignatures.hpp>
+#include <ClassNodeIndex.hpp>
+#include <NeighborIntersection.hpp>
+#include <LevelClassTables.hpp>
+#include <ClassCountKernels.hpp>
 
 namespace vflib
 {
@@ -50,21 +57,18 @@ namespace vflib
 		//BE AWARE: Core nodes are also counted by these
 		//GLOBAL SIZE
 		uint32_t t2in_len, t2both_len, t2out_len; //Len of Terminal set for the second graph
-		uint32_t *t1in_len, *t1both_len, *t1out_len; //Len of Terminal set for the first graph for each level
 												//SIZE FOR EACH CLASS
 		uint32_t *t2both_len_c, *t2in_len_c, *t2out_len_c;     //Len of Terminal set for the second graph for each class
-		uint32_t **t1both_len_c, **t1in_len_c, **t1out_len_c;  //Len of Terminal set for the first graph for each class end level
 
 		//Used for terminal set size evaluation
 		uint32_t *termout2_c, *termin2_c, *new2_c;
-		uint32_t **termout1_c, **termin1_c, **new1_c;
-		uint32_t *termin1, *termout1, *new1;
+		std::vector<uint32_t> *touched2_c;  //Classes counted by the last feasibility check, to be cleared
 
-		//Terminal sets of the second graph
-		//TERM IN
-		nodeID_t *in_2;
-		//TERMI OUT
-		nodeID_t *out_2;
+		//Terminal set sizes of the first graph for each level, overall and for each class
+		LevelClassTables *levels;
+
+		//Core and terminal sets of the second graph, with the classes of its nodes
+		TargetNodeRecord *records;
 
 		//Vector of sets used for searching the successors
 		//Each class has its set
@@ -74,6 +78,10 @@ namespace vflib
 		uint32_t *class_1;       //Classes for nodes of the first graph
 		uint32_t *class_2;       //Classes for nodes of the first graph
 		uint32_t classes_count;  //Number of classes
+		std::shared_ptr<const ClassNodeIndex> class_nodes;  //Nodes of the second graph by class
+		const CandidateDomains *domains;  //Candidates of the nodes of the first graph, NULL if not used
+		const NeighborSignatures *signatures;  //Neighbor classes of the nodes, NULL if not used
+		NeighborIntersection *intersection;  //Candidates from all the mapped neighbors, NULL if not used
 
 		//PRIVATE METHODS
 		void BackTrack();
@@ -84,11 +92,16 @@ namespace vflib
 		static long long instance_count;
 		VF3SubState(ARGraph<Node1, Edge1> *g1, ARGraph<Node2, Edge2> *g2,
 			uint32_t* class_1, uint32_t* class_2, uint32_t nclass,
-			nodeID_t* order = NULL, bool edgeInduced = false);
+			nodeID_t* order = NULL, bool edgeInduced = false, TargetWorkspace *workspace = NULL);
 		VF3SubState(const VF3SubState &state);
 		~VF3SubState();
 		inline ARGraph<Node1, Edge1> *GetGraph1() const { return g1; }
 		inline ARGraph<Node2, Edge2> *GetGraph2() const { return g2; }
+		//The domains are shared by all the states and must outlive them
+		inline void SetCandidateDomains(const CandidateDomains *d) { domains = d; }
+		inline void SetNeighborSignatures(const NeighborSignatures *s) { signatures = s; }
+		//The intersection must be built on the same order of the state
+		inline void SetNeighborIntersection(NeighborIntersection *i) { intersection = i; }
 		bool NextPair(nodeID_t *pn1, nodeID_t *pn2,
 			nodeID_t prev_n1 = NULL_NODE, nodeID_t prev_n2 = NULL_NODE);
 		bool IsFeasiblePair(nodeID_t n1, nodeID_t n2);
@@ -107,8 +120,8 @@ namespace vflib
 		VF3SubState<Node1, Node2, Edge1, Edge2, NodeComparisonFunctor, EdgeComparisonFunctor>
 		::VF3SubState(ARGraph<Node1, Edge1> *ag1, ARGraph<Node2, Edge2> *ag2, 
 			uint32_t* class_1, uint32_t* class_2, uint32_t nclass, nodeID_t* order,
-			bool edgeInduced)
-		:State(ag1->NodeCount(), ag2->NodeCount(), order, edgeInduced)
+			bool edgeInduced, TargetWorkspace *workspace)
+		:State(ag1->NodeCount(), ag2->NodeCount(), order, edgeInduced, class_2, workspace)
 	{
 		assert(class_1 != NULL && class_2 != NULL);
 
@@ -121,57 +134,28 @@ namespace vflib
 		this->class_1 = class_1;
 		this->class_2 = class_2;
 		this->classes_count = nclass;
+		class_nodes = this->workspace->ClassNodes();
+		records = this->workspace->Records();
+		domains = NULL;
+		signatures = NULL;
+		intersection = NULL;
 		t2both_len = t2in_len = t2out_len = 0;
 
 		//Creazione degli insiemi
-		t1both_len = new uint32_t[n1 + 1];
-		t1in_len = new uint32_t[n1 + 1];
-		t1out_len = new uint32_t[n1 + 1];
-
-		termin1 = (uint32_t*)calloc(n1, sizeof(uint32_t));
-		termout1 = (uint32_t*)calloc(n1, sizeof(uint32_t));
-		new1 = (uint32_t*)calloc(n1, sizeof(uint32_t));
-
-		t1both_len_c = (uint32_t**)malloc((n1 + 1) * sizeof(uint32_t*));
-		t1in_len_c = (uint32_t**)malloc((n1 + 1) * sizeof(uint32_t*));
-		t1out_len_c = (uint32_t**)malloc((n1 + 1) * sizeof(uint32_t*));
-
-		termin1_c = (uint32_t**)malloc(n1 * sizeof(uint32_t*));
-		termout1_c = (uint32_t**)malloc(n1 * sizeof(uint32_t*));
-		new1_c = (uint32_t**)malloc(n1 * sizeof(uint32_t*));
-
-		core_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		t2both_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		t2in_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		t2out_len_c = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
+		levels = new LevelClassTables(n1 + 1, classes_count);
+
+		core_len_c = new uint32_t[classes_count]();
+		t2both_len_c = new uint32_t[classes_count]();
+		t2in_len_c = new uint32_t[classes_count]();
+		t2out_len_c = new uint32_t[classes_count]();
 		termout2_c = new uint32_t[classes_count];
 		termin2_c = new uint32_t[classes_count];
-		new2_c = new uint32_t[classes_count];
+		new2_c = new uint32_t[classes_count]();
+		touched2_c = new std::vector<uint32_t>();
 
-		in_2 = new nodeID_t[n2];
-		out_2 = new nodeID_t[n2];
 		dir = new nodeDir_t[n1];
 		predecessors = new nodeID_t[n1];
 
-		uint32_t i;
-		for (i = 0; i <= n1; i++)
-		{
-			if (i < n1) {
-				termin1_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-				termout1_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-				new1_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-			}
-			t1both_len_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-			t1in_len_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-			t1out_len_c[i] = (uint32_t*)calloc(classes_count, sizeof(uint32_t));
-		}
-
-		for (i = 0; i < n2; i++)
-		{
-			in_2[i] = 0;
-			out_2[i] = 0;
-		}
-
 		ComputeFirstGraphTraversing();
 	}
 
@@ -192,38 +176,30 @@ namespace vflib
 		class_1 = state.class_1;
 		class_2 = state.class_2;
 		classes_count = state.classes_count;
+		class_nodes = state.class_nodes;
+		domains = state.domains;
+		signatures = state.signatures;
+		intersection = state.intersection;
 
 		last_candidate_index = state.last_candidate_index;
 
-		t1in_len = state.t1in_len;
-		t1out_len = state.t1out_len;
-		t1both_len = state.t1both_len;
+		levels = state.levels;
 
 		t2in_len = state.t2in_len;
 		t2out_len = state.t2out_len;
 		t2both_len = state.t2both_len;
 
 		core_len_c = state.core_len_c;
-		t1both_len_c = state.t1both_len_c;
 		t2both_len_c = state.t2both_len_c;
-		t1in_len_c = state.t1in_len_c;
 		t2in_len_c = state.t2in_len_c;
-		t1out_len_c = state.t1out_len_c;
 		t2out_len_c = state.t2out_len_c;
 
-		termout1_c = state.termout1_c;
 		termout2_c = state.termout2_c;
-		termin1_c = state.termin1_c;
 		termin2_c = state.termin2_c;
-		new1_c = state.new1_c;
 		new2_c = state.new2_c;
+		touched2_c = state.touched2_c;
 
-		termin1 = state.termin1;
-		termout1 = state.termout1;
-		new1 = state.new1;
-
-		in_2 = state.in_2;
-		out_2 = state.out_2;
+		records = state.records;
 		dir = state.dir;
 		predecessors = state.predecessors;
 	}
@@ -244,34 +220,9 @@ namespace vflib
 
 		if (*share_count == 0)
 		{
-			delete[] in_2;
-			delete[] out_2;
 			delete[] dir;
 			delete[] predecessors;
-			delete[] t1both_len;
-			delete[] t1in_len;
-			delete[] t1out_len;
-			delete[] termin1;
-			delete[] termout1;
-			delete[] new1;
-
-			for (uint32_t i = 0; i <= n1; i++) {
-				delete[] t1both_len_c[i];
-				delete[] t1in_len_c[i];
-				delete[] t1out_len_c[i];
-				if (i < n1) {
-					delete[] termin1_c[i];
-					delete[] termout1_c[i];
-					delete[] new1_c[i];
-				}
-			}
-
-			delete[] t1both_len_c;
-			delete[] t1in_len_c;
-			delete[] t1out_len_c;
-			delete[] termin1_c;
-			delete[] termout1_c;
-			delete[] new1_c;
+			delete levels;
 			delete[] t2both_len_c;
 			delete[] t2in_len_c;
 			delete[] t2out_len_c;
@@ -279,6 +230,7 @@ namespace vflib
 			delete[] termin2_c;
 			delete[] termout2_c;
 			delete[] new2_c;
+			delete touched2_c;
 		}
 	}
 
@@ -289,6 +241,12 @@ namespace vflib
 		EdgeComparisonFunctor>::UpdateTerminalSetSize(nodeID_t node, nodeID_t level, bool* in_1, bool* out_1, bool* inserted) {
 		nodeID_t i, neigh, c_neigh;
 		nodeID_t in1_count, out1_count;
+		uint32_t &termin1 = levels->Total(level, LevelClassTables::TERM_IN);
+		uint32_t &termout1 = levels->Total(level, LevelClassTables::TERM_OUT);
+		uint32_t &new1 = levels->Total(level, LevelClassTables::NEW);
+		uint32_t *termin1_c = levels->Classes(level, LevelClassTables::TERM_IN);
+		uint32_t *termout1_c = levels->Classes(level, LevelClassTables::TERM_OUT);
+		uint32_t *new1_c = levels->Classes(level, LevelClassTables::NEW);
 
 		//Updating Terminal set size count And degree
 		in1_count = g1->InEdgeCount(node);
@@ -304,16 +262,16 @@ namespace vflib
 			if (!inserted[neigh])
 			{
 				if (in_1[neigh]) {
-					termin1[level]++;
-					termin1_c[level][c_neigh]++;
+					termin1++;
+					termin1_c[c_neigh]++;
 				}
 				if (out_1[neigh]) {
-					termout1[level]++;
-					termout1_c[level][c_neigh]++;
+					termout1++;
+					termout1_c[c_neigh]++;
 				}
 				if (!in_1[neigh] && !out_1[neigh]) {
-					new1[level]++;
-					new1_c[level][c_neigh]++;
+					new1++;
+					new1_c[c_neigh]++;
 				}
 			}
 		}
@@ -327,16 +285,16 @@ namespace vflib
 			if (!inserted[neigh])
 			{
 				if (in_1[neigh]) {
-					termin1[level]++;
-					termin1_c[level][c_neigh]++;
+					termin1++;
+					termin1_c[c_neigh]++;
 				}
 				if (out_1[neigh]) {
-					termout1[level]++;
-					termout1_c[level][c_neigh]++;
+					termout1++;
+					termout1_c[c_neigh]++;
 				}
 				if (!in_1[neigh] && !out_1[neigh]) {
-					new1[level]++;
-					new1_c[level][c_neigh]++;
+					new1++;
+					new1_c[c_neigh]++;
 				}
 			}
 		}
@@ -364,10 +322,6 @@ namespace vflib
 		node = 0;
 		node_c = 0;
 
-		t1in_len[0] = 0;
-		t1out_len[0] = 0;
-		t1both_len[0] = 0;
-
 		for (i = 0; i < n1; i++)
 		{
 			in[i] = false;
@@ -387,15 +341,18 @@ namespace vflib
 			UpdateTerminalSetSize(node, depth, in, out, inserted);
 
 			//Updating counters for next step
-			t1in_len[depth + 1] = t1in_len[depth];
-			t1out_len[depth + 1] = t1out_len[depth];
-			t1both_len[depth + 1] = t1both_len[depth];
-			for (uint32_t j = 0; j < classes_count; j++)
-			{
-				t1in_len_c[depth + 1][j] = t1in_len_c[depth][j];
-				t1out_len_c[depth + 1][j] = t1out_len_c[depth][j];
-				t1both_len_c[depth + 1][j] = t1both_len_c[depth][j];
-			}
+			uint32_t &t1both_len = levels->Total(depth + 1, LevelClassTables::T1_BOTH);
+			uint32_t &t1in_len = levels->Total(depth + 1, LevelClassTables::T1_IN);
+			uint32_t &t1out_len = levels->Total(depth + 1, LevelClassTables::T1_OUT);
+			uint32_t *t1both_len_c = levels->Classes(depth + 1, LevelClassTables::T1_BOTH);
+			uint32_t *t1in_len_c = levels->Classes(depth + 1, LevelClassTables::T1_IN);
+			uint32_t *t1out_len_c = levels->Classes(depth + 1, LevelClassTables::T1_OUT);
+			t1both_len = levels->Total(depth, LevelClassTables::T1_BOTH);
+			t1in_len = levels->Total(depth, LevelClassTables::T1_IN);
+			t1out_len = levels->Total(depth, LevelClassTables::T1_OUT);
+			//The rows of the three tables are contiguous
+			memcpy(t1both_len_c, levels->Classes(depth, LevelClassTables::T1_BOTH),
+				3 * classes_count * sizeof(uint32_t));
 			//Inserting the node
 			//Terminal set sizes depends on the depth
 			// < depth non sono nell'insieme
@@ -403,22 +360,22 @@ namespace vflib
 			if (!in[node])
 			{
 				in[node] = true;
-				t1in_len[depth + 1]++;
-				t1in_len_c[depth + 1][node_c]++;
+				t1in_len++;
+				t1in_len_c[node_c]++;
 				if (out[node]) {
-					t1both_len[depth + 1]++;
-					t1both_len_c[depth + 1][node_c]++;
+					t1both_len++;
+					t1both_len_c[node_c]++;
 				}
 			}
 
 			if (!out[node])
 			{
 				out[node] = true;
-				t1out_len[depth + 1]++;
-				t1out_len_c[depth + 1][node_c]++;
+				t1out_len++;
+				t1out_len_c[node_c]++;
 				if (in[node]) {
-					t1both_len[depth + 1]++;
-					t1both_len_c[depth + 1][node_c]++;
+					t1both_len++;
+					t1both_len_c[node_c]++;
 				}
 			}
 
@@ -431,8 +388,8 @@ namespace vflib
 				{
 					other_c = class_1[other];
 					in[other] = true;
-					t1in_len[depth + 1]++;
-					t1in_len_c[depth + 1][other_c]++;
+					t1in_len++;
+					t1in_len_c[other_c]++;
 					if (!inserted[other])
 					{
 						if (predecessors[other] == NULL_NODE)
@@ -442,8 +399,8 @@ namespace vflib
 						}
 					}
 					if (out[other]) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][other_c]++;
+						t1both_len++;
+						t1both_len_c[other_c]++;
 					}
 				}
 			}
@@ -455,8 +412,8 @@ namespace vflib
 				{
 					other_c = class_1[other];
 					out[other] = true;
-					t1out_len[depth + 1]++;
-					t1out_len_c[depth + 1][other_c]++;
+					t1out_len++;
+					t1out_len_c[other_c]++;
 					if (!inserted[other])
 					{
 						if (predecessors[other] == NULL_NODE)
@@ -466,8 +423,8 @@ namespace vflib
 						}
 					}
 					if (in[other]) {
-						t1both_len[depth + 1]++;
-						t1both_len_c[depth + 1][other_c]++;
+						t1both_len++;
+						t1both_len_c[other_c]++;
 					}
 				}
 			}
@@ -476,6 +433,8 @@ namespace vflib
 		delete[] in;
 		delete[] out;
 		delete[] inserted;
+
+		levels->BuildActiveClasses();
 	}
 
 	template <typename Node1, typename Node2,
@@ -497,6 +456,31 @@ namespace vflib
 
 		nodeID_t pred = predecessors[curr_n1];
 
+		if (intersection && intersection->ConstraintCount(curr_n1) > 1)
+		{
+			//Candidates adjacent to the images of all the mapped neighbors
+			if (prev_n2 == NULL_NODE)
+			{
+				intersection->Intersect(g2, curr_n1, core_len, core_1, class_2, c);
+				last_candidate_index = 0;
+			}
+			else
+				last_candidate_index++;
+
+			const std::vector<nodeID_t> &candidates = intersection->Candidates(core_len);
+			pred_set_size = (nodeID_t)candidates.size();
+			while (last_candidate_index < pred_set_size
+				&& (records[candidates[last_candidate_index]].core != NULL_NODE
+					|| (domains && !domains->Contains(curr_n1, candidates[last_candidate_index]))))
+				last_candidate_index++;
+
+			if (last_candidate_index >= pred_set_size)
+				return false;
+			*pn1 = curr_n1;
+			*pn2 = candidates[last_candidate_index];
+			return true;
+		}
+
 		if (pred != NULL_NODE)
 		{
 			if (prev_n2 == NULL_NODE)
@@ -506,55 +490,72 @@ namespace vflib
 			}
 
 			pred_pair = core_1[pred];
+			const nodeID_t *candidates = NULL;
 			switch (dir[curr_n1])
 			{
 			case NODE_DIR_IN:
-				pred_set_size = g2->InEdgeCount(pred_pair);
-
-				while (last_candidate_index < pred_set_size)
+				if (g2->HasClassIndex(class_2))
+					candidates = g2->GetInEdgesOfClass(pred_pair, c, pred_set_size);
+				else
 				{
-					prev_n2 = g2->GetInEdge(pred_pair, last_candidate_index);
-					if (core_2[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
-						last_candidate_index++;
-					else
-						break;
+					candidates = g2->GetInEdgeSet(pred_pair);
+					pred_set_size = g2->InEdgeCount(pred_pair);
 				}
-
 				break;
 
 			case NODE_DIR_OUT:
-				pred_set_size = g2->OutEdgeCount(pred_pair);
-
-				while (last_candidate_index < pred_set_size)
+				if (g2->HasClassIndex(class_2))
+					candidates = g2->GetOutEdgesOfClass(pred_pair, c, pred_set_size);
+				else
 				{
-					prev_n2 = g2->GetOutEdge(pred_pair, last_candidate_index);
-					if (core_2[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
-						last_candidate_index++;
-					else
-						break;
+					candidates = g2->GetOutEdgeSet(pred_pair);
+					pred_set_size = g2->OutEdgeCount(pred_pair);
 				}
-
 				break;
 			}
 
+			while (last_candidate_index < pred_set_size)
+			{
+				prev_n2 = candidates[last_candidate_index];
+				if (records[prev_n2].core != NULL_NODE || records[prev_n2].cls != c
+					|| (domains && !domains->Contains(curr_n1, prev_n2)))
+					last_candidate_index++;
+				else
+					break;
+			}
+
 			if (last_candidate_index >= pred_set_size)
 				return false;
 
 		}
 		else
 		{
-			//Recupero il nodo dell'esterno
+			//Without a predecessor only the candidates of the node, or
+			//else the nodes of its class, are scanned
+			const nodeID_t *candidates;
 			if (prev_n2 == NULL_NODE)
-				prev_n2 = 0;
+				last_candidate_index = 0;
 			else
-				prev_n2++;
+				last_candidate_index++;
 
-			while (prev_n2 < n2 &&
-				(core_2[prev_n2] != NULL_NODE
-					|| class_2[prev_n2] != c))
+			if (domains)
+			{
+				candidates = domains->Candidates(curr_n1);
+				pred_set_size = domains->Size(curr_n1);
+			}
+			else
 			{
-				prev_n2++;
+				candidates = class_nodes->Nodes(c);
+				pred_set_size = class_nodes->Size(c);
 			}
+
+			while (last_candidate_index < pred_set_size
+				&& records[candidates[last_candidate_index]].core != NULL_NODE)
+				last_candidate_index++;
+
+			if (last_candidate_index >= pred_set_size)
+				return false;
+			prev_n2 = candidates[last_candidate_index];
 		}
 		//std::cout<<curr_n1 << " " << prev_n2 << " \n";
 
@@ -591,7 +592,7 @@ namespace vflib
 		assert(node1 < n1);
 		assert(node2 < n2);
 		assert(core_1[node1] == NULL_NODE);
-		assert(core_2[node2] == NULL_NODE);
+		assert(records[node2].core == NULL_NODE);
 
 		if (!nf(g1->GetNodeAttr(node1), g2->GetNodeAttr(node2)))
 			return false;
@@ -600,13 +601,20 @@ namespace vflib
 			|| g1->OutEdgeCount(node1) > g2->OutEdgeCount(node2))
 			return false;
 
+		if (signatures && !signatures->Compatible(node1, node2))
+			return false;
+
 		uint32_t i, other1, other2, c_other;
 		Edge1 eattr1;
 		Edge2 eattr2;
 		uint32_t termout2 = 0, termin2 = 0, new2 = 0;
-		memset(termin2_c, 0, classes_count * sizeof(uint32_t));
-		memset(termout2_c, 0, classes_count * sizeof(uint32_t));
-		memset(new2_c, 0, classes_count * sizeof(uint32_t));
+		//Only the classes counted by the last check are cleared
+		for (i = 0; i < touched2_c->size(); i++)
+		{
+			c_other = (*touched2_c)[i];
+			termin2_c[c_other] = termout2_c[c_other] = new2_c[c_other] = 0;
+		}
+		touched2_c->clear();
 
 		// Check the 'out' edges of node1
 		for (i = 0; i < g1->OutEdgeCount(node1); i++)
@@ -617,7 +625,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(node2, other2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -631,7 +639,7 @@ namespace vflib
 			{
 				other2 = core_1[other1];
 				if (!g2->HasEdge(other2, node2, eattr2) ||
-					!ef(eattr1, eattr2))
+					!CompatibleEdges(ef, eattr1, eattr2))
 					return false;
 			}
 		}
@@ -641,28 +649,30 @@ namespace vflib
 		for (i = 0; i < g2->OutEdgeCount(node2); i++)
 		{
 			other2 = g2->GetOutEdge(node2, i);
-			c_other = class_2[other2];
-			if (core_2[other2] != NULL_NODE)
+			c_other = records[other2].cls;
+			if (records[other2].core != NULL_NODE)
 			{
 				if(!edgeInduced)
 				{
 					// std::cout << "Node-induced constraint" << std::endl;
-					other1 = core_2[other2];
+					other1 = records[other2].core;
 					if (!g1->HasEdge(node1, other1))
 						return false;
 				}
 			}
 			else
 			{
-				if (in_2[other2]) {
+				if (!termin2_c[c_other] && !termout2_c[c_other] && !new2_c[c_other])
+					touched2_c->push_back(c_other);
+				if (records[other2].in) {
 					termin2++;
 					termin2_c[c_other]++;
 				}
-				if (out_2[other2]) {
+				if (records[other2].out) {
 					termout2++;
 					termout2_c[c_other]++;
 				}
-				if (!in_2[other2] && !out_2[other2]) {
+				if (!records[other2].in && !records[other2].out) {
 					new2++;
 					new2_c[c_other]++;
 				}
@@ -673,28 +683,30 @@ namespace vflib
 		for (i = 0; i < g2->InEdgeCount(node2); i++)
 		{
 			other2 = g2->GetInEdge(node2, i);
-			c_other = class_2[other2];
-			if (core_2[other2] != NULL_NODE)
+			c_other = records[other2].cls;
+			if (records[other2].core != NULL_NODE)
 			{
 				if(!edgeInduced)
 				{
 					// std::cout << "Node-induced constraint" << std::endl;
-					other1 = core_2[other2];
+					other1 = records[other2].core;
 					if (!g1->HasEdge(other1, node1))
 						return false;
 				}
 			}
 			else
 			{
-				if (in_2[other2]) {
+				if (!termin2_c[c_other] && !termout2_c[c_other] && !new2_c[c_other])
+					touched2_c->push_back(c_other);
+				if (records[other2].in) {
 					termin2++;
 					termin2_c[c_other]++;
 				}
-				if (out_2[other2]) {
+				if (records[other2].out) {
 					termout2++;
 					termout2_c[c_other]++;
 				}
-				if (!in_2[other2] && !out_2[other2]) {
+				if (!records[other2].in && !records[other2].out) {
 					new2++;
 					new2_c[c_other]++;
 				}
@@ -702,43 +714,20 @@ namespace vflib
 		}
 
 		//Look-ahead check
-		if (termin1[core_len] <= termin2 && termout1[core_len] <= termout2) {
-			for (i = 0; i < classes_count; i++) {
-				if (termin1_c[core_len][i] > termin2_c[i] ||
-					termout1_c[core_len][i] > termout2_c[i]) {
-					return false;
-				}
-			}
-		}
-		else return false;
-
-        if(!edgeInduced)
-        {
-            if (new1[core_len] <= new2)
-            {
-                for (i = 0; i < classes_count; i++) {
-                    if (new1_c[core_len][i] > new2_c[i])
-                        return false;
-                }
-            }
-            else return false;
-        }
-        else
-        {
-            if(new1[core_len]+termin1[core_len]+termout1[core_len] <= 
-                new2+termin2+termout2)
-            {
-                for (i = 0; i < classes_count; i++) 
-                {
-				    if (termin1_c[core_len][i]+termout1_c[core_len][i]+new1_c[core_len][i] > 
-                            termin2_c[i]+termout2_c[i]+new2_c[i]) 
-                    {
-					    return false;
-				    }
-			    }
-            }
-            else return false;
-        }
+		const uint32_t termin1 = levels->Total(core_len, LevelClassTables::TERM_IN);
+		const uint32_t termout1 = levels->Total(core_len, LevelClassTables::TERM_OUT);
+		const uint32_t new1 = levels->Total(core_len, LevelClassTables::NEW);
+		const uint32_t *termin1_c = levels->Classes(core_len, LevelClassTables::TERM_IN);
+		const uint32_t *termout1_c = levels->Classes(core_len, LevelClassTables::TERM_OUT);
+		const uint32_t *new1_c = levels->Classes(core_len, LevelClassTables::NEW);
+		if (termin1 > termin2 || termout1 > termout2)
+			return false;
+		//Edge-induced: the new nodes of the target can also be matched to terminal nodes
+		if (!edgeInduced ? new1 > new2 : new1 + termin1 + termout1 > new2 + termin2 + termout2)
+			return false;
+		if (classcounts::AnyExceeds(termin1_c, termout1_c, new1_c, termin2_c, termout2_c, new2_c, classes_count,
+			levels->ActiveClasses(core_len), levels->ActiveCount(core_len), edgeInduced))
+			return false;
 		//std::cout << "\nIs Feasible: " << node1 << " " << node2;
 		return true;
 
@@ -766,7 +755,7 @@ namespace vflib
 		assert(node2 < n2);
 		assert(core_len < n1);
 		assert(core_len < n2);
-		assert(class_1[node1] == class_2[node2]);
+		assert(class_1[node1] == records[node2].cls);
 
 		//Updating the core length
 		core_len++;
@@ -775,24 +764,24 @@ namespace vflib
 		core_len_c[node_c]++;
 
 		//Checking if node2 is not in T2_in
-		if (!in_2[node2])
+		if (!records[node2].in)
 		{
-			in_2[node2] = core_len;
+			records[node2].in = core_len;
 			t2in_len++;
 			t2in_len_c[node_c]++;
-			if (out_2[node2]) {
+			if (records[node2].out) {
 				t2both_len++;
 				t2both_len_c[node_c]++;
 			}
 		}
 
 		//Checking if node2 is not in T2_in
-		if (!out_2[node2])
+		if (!records[node2].out)
 		{
-			out_2[node2] = core_len;
+			records[node2].out = core_len;
 			t2out_len++;
 			t2out_len_c[node_c]++;
-			if (in_2[node2]) {
+			if (records[node2].in) {
 				t2both_len++;
 				t2both_len_c[node_c]++;
 			}
@@ -800,7 +789,7 @@ namespace vflib
 
 		//Inserting nodes into the core set
 		core_1[node1] = node2;
-		core_2[node2] = node1;
+		records[node2].core = node1;
 
 		//Evaluation of the neighborhood
 		uint32_t i, other, other_c;
@@ -809,14 +798,14 @@ namespace vflib
 		for (i = 0; i < g2->InEdgeCount(node2); i++)
 		{
 			other = g2->GetInEdge(node2, i);
-			if (!in_2[other])
+			if (!records[other].in)
 			{
-				other_c = class_2[other];
-				in_2[other] = core_len;
+				other_c = records[other].cls;
+				records[other].in = core_len;
 				//in2_set[other_c].push_back(other);
 				t2in_len++;
 				t2in_len_c[other_c]++;
-				if (out_2[other]) {
+				if (records[other].out) {
 					t2both_len++;
 					t2both_len_c[other_c]++;
 				}
@@ -826,14 +815,14 @@ namespace vflib
 		for (i = 0; i < g2->OutEdgeCount(node2); i++)
 		{
 			other = g2->GetOutEdge(node2, i);
-			if (!out_2[other])
+			if (!records[other].out)
 			{
-				other_c = class_2[other];
-				out_2[other] = core_len;
+				other_c = records[other].cls;
+				records[other].out = core_len;
 				//out2_set[other_c].push_back(other);
 				t2out_len++;
 				t2out_len_c[other_c]++;
-				if (in_2[other]) {
+				if (records[other].in) {
 					t2both_len++;
 					t2both_len_c[other_c]++;
 				}
@@ -868,19 +857,19 @@ namespace vflib
 			uint32_t i, node2;
 			node2 = core_1[added_node1];
 
-			if (in_2[node2] == core_len) {
-				in_2[node2] = 0;
+			if (records[node2].in == core_len) {
+				records[node2].in = 0;
 				//in2_set[node_c].erase(node2);
 				t2in_len_c[node_c]--;
-				if (out_2[node2])
+				if (records[node2].out)
 					t2both_len_c[node_c]--;
 			}
 
-			if (out_2[node2] == core_len) {
-				out_2[node2] = 0;
+			if (records[node2].out == core_len) {
+				records[node2].out = 0;
 				//out2_set[node_c].erase(node2);
 				t2out_len_c[node_c]--;
-				if (in_2[node2])
+				if (records[node2].in)
 					t2both_len_c[node_c]--;
 
 			}
@@ -889,12 +878,12 @@ namespace vflib
 			for (i = 0; i < g2->InEdgeCount(node2); i++)
 			{
 				uint32_t other = g2->GetInEdge(node2, i);
-				other_c = class_2[other];
-				if (in_2[other] == core_len) {
-					in_2[other] = 0;
+				other_c = records[other].cls;
+				if (records[other].in == core_len) {
+					records[other].in = 0;
 					//in2_set[other_c].erase(other);
 					t2in_len_c[other_c] --;
-					if (out_2[other])
+					if (records[other].out)
 						t2both_len_c[other_c]--;
 				}
 			}
@@ -902,18 +891,18 @@ namespace vflib
 			for (i = 0; i < g2->OutEdgeCount(node2); i++)
 			{
 				uint32_t other = g2->GetOutEdge(node2, i);
-				other_c = class_2[other];
-				if (out_2[other] == core_len) {
-					out_2[other] = 0;
+				other_c = records[other].cls;
+				if (records[other].out == core_len) {
+					records[other].out = 0;
 					//out2_set[other_c].erase(other);
 					t2out_len_c[other_c] --;
-					if (in_2[other])
+					if (records[other].in)
 						t2both_len_c[other_c]--;
 				}
 			}
 
 			core_1[added_node1] = NULL_NODE;
-			core_2[node2] = NULL_NODE;
+			records[node2].core = NULL_NODE;
 
 			core_len = orig_core_len;
 			core_len_c[node_c]--;
@@ -927,16 +916,23 @@ namespace vflib
 		bool VF3SubState<Node1, Node2, Edge1, Edge2,
 		NodeComparisonFunctor, EdgeComparisonFunctor>::IsDead() const {
 
-		if (t1both_len[core_len] > t2both_len ||
-			t1out_len[core_len] > t2out_len ||
-			t1in_len[core_len] > t2in_len) {
+		if (domains && domains->HasEmptyDomain())
+			return true;
+
+		const uint32_t *t1both_len_c = levels->Classes(core_len, LevelClassTables::T1_BOTH);
+		const uint32_t *t1in_len_c = levels->Classes(core_len, LevelClassTables::T1_IN);
+		const uint32_t *t1out_len_c = levels->Classes(core_len, LevelClassTables::T1_OUT);
+
+		if (levels->Total(core_len, LevelClassTables::T1_BOTH) > t2both_len ||
+			levels->Total(core_len, LevelClassTables::T1_OUT) > t2out_len ||
+			levels->Total(core_len, LevelClassTables::T1_IN) > t2in_len) {
 			return true;
 		}
 
 		for (uint32_t c = 0; c < classes_count; c++) {
-			if (t1both_len_c[core_len][c] > t2both_len_c[c] ||
-				t1out_len_c[core_len][c] > t2out_len_c[c] ||
-				t1in_len_c[core_len][c] > t2in_len_c[c]) {
+			if (t1both_len_c[c] > t2both_len_c[c] ||
+				t1out_len_c[c] > t2out_len_c[c] ||
+				t1in_len_c[c] > t2in_len_c[c]) {
 				return true;
 			}
 		}
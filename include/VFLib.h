@@ -3,22 +3,36 @@
 
 #include "loaders/ARGLoader.hpp"
 #include "loaders/FastStreamARGLoader.hpp"
+#include "loaders/ParallelTextARGLoader.hpp"
 #include "loaders/EdgeStreamARGLoader.hpp"
+#include "loaders/BinaryARGLoader.hpp"
+#include "loaders/InterningARGLoader.hpp"
 #include "ARGraph.hpp"
+#include "ARGraphSnapshot.hpp"
+#include "LabelDictionary.hpp"
 #include "NodeSorter.hpp"
 #include "VF3NodeSorter.hpp"
 #include "RINodeSorter.hpp"
 #include "FastCheck.hpp"
 #include "State.hpp"
+#include "TargetProfile.hpp"
 #include "ProbabilityStrategy.hpp"
 #include "NodeClassifier.hpp"
+#include "HashNodeClassifier.hpp"
+#include "CandidateDomains.hpp"
+#include "NeighborSignatures.hpp"
+#include "TargetReduction.hpp"
+#include "ClassNodeIndex.hpp"
+#include "TargetWorkspace.hpp"
+#include "NeighborIntersection.hpp"
 #include "MatchingEngine.hpp"
 
 
 #ifndef VF3BIO
 typedef int32_t data_t;
 #else
-typedef std::string data_t;
+typedef std::string label_t;	/**<Labels of the nodes in the files */
+typedef uint32_t data_t;		/**<Labels are matched by their id in a LabelDictionary */
 #endif
 
 #ifdef VF3
@@ -27,6 +41,9 @@ typedef vflib::VF3SubState<data_t, data_t, vflib::Empty, vflib::Empty> state_t;
 #elif defined(VF3L)
 #include "VF3LightSubState.hpp"
 typedef vflib::VF3LightSubState<data_t, data_t, vflib::Empty, vflib::Empty> state_t;
+#elif defined(VF3B)
+#include "VF3BitSubState.hpp"
+typedef vflib::VF3BitSubState<data_t, data_t, vflib::Empty, vflib::Empty> state_t;
 #elif defined(VF3P)
 #include "parallel/ParallelMatchingEngine.hpp"
 #include "parallel/ParallelMatchingEngineWLS.hpp"
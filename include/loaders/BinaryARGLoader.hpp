@@ -0,0 +1,192 @@
+/**
+ * @file BinaryARGLoader.hpp
+ * @brief An implementation of the ARGLoader interface for reading
+ *        graphs in the MIVIA binary format
+ * @details The file is a sequence of little-endian words: the number of
+ *        nodes, then for each node the number of its out edges followed
+ *        by the ids of their end nodes. The format has no attributes, so
+ *        nodes and edges get default constructed ones.
+ *        The original datasets use 16-bit words; a 32-bit variant of the
+ *        format is supported for graphs with more than 65535 nodes.
+ */
+
+#ifndef BINARYARGLOADER_HPP
+#define BINARYARGLOADER_HPP
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <Error.hpp>
+
+#include "ARGraph.hpp"
+
+namespace vflib {
+
+template <typename Node, typename Edge, typename Word = uint16_t>
+class BinaryARGLoader: public ARGLoader<Node, Edge> {
+    public:
+        /**
+         * @brief Reads the graph data from a binary istream
+         * @param in The input stream, read with a single bulk read
+         * @param undirected If true, the graph is undirected
+         */
+        BinaryARGLoader(std::istream &in, bool undirected=false);
+        virtual uint32_t NodeCount() const;
+        virtual Node GetNodeAttr(nodeID_t node);
+        virtual uint32_t OutEdgeCount(nodeID_t node) const;
+        virtual nodeID_t GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr);
+        virtual bool ReleaseGraphData(ARGraphData<Node, Edge> &data);
+
+    private:
+        uint32_t node_count;
+        std::vector<uint32_t> offset;   /**<start of the edges of each node in targets (node_count+1 entries) */
+        std::vector<nodeID_t> targets;  /**<end nodes of the edges, sorted for each node */
+
+        static uint32_t DecodeWord(const unsigned char *p);
+};
+
+/**
+ * @brief Decodes a little-endian word
+ */
+template <typename Node, typename Edge, typename Word>
+inline uint32_t
+BinaryARGLoader<Node,Edge,Word>
+::DecodeWord(const unsigned char *p) {
+    uint32_t w = 0;
+    for (size_t b = 0; b < sizeof(Word); b++)
+        w |= (uint32_t)p[b] << (8 * b);
+    return w;
+}
+
+template <typename Node, typename Edge, typename Word>
+BinaryARGLoader<Node,Edge,Word>
+::BinaryARGLoader(std::istream &in, bool undirected) {
+    if (!in.good())
+      error("End of file or reading error");
+
+    in.seekg(0, std::ios::end);
+    std::streamoff size = in.tellg();
+    in.seekg(0, std::ios::beg);
+    if (size < (std::streamoff)sizeof(Word) || size % sizeof(Word))
+        error("Error in file format: size is not a multiple of the word size");
+
+    std::vector<unsigned char> buffer((size_t)size);
+    if (!in.read((char*)buffer.data(), size))
+        error("End of file or reading error");
+
+    const unsigned char *words = buffer.data();
+    size_t word_count = (size_t)size / sizeof(Word);
+    size_t pos, w;
+    nodeID_t i, n2;
+    uint32_t j, edge_count;
+
+    node_count = DecodeWord(words);
+    offset.assign(node_count + 1, 0);
+
+    // First pass: validation and degrees
+    pos = 1;
+    for (i = 0; i < node_count; i++) {
+        if (pos >= word_count)
+            error("Error in file format reading node %u", i);
+        edge_count = DecodeWord(words + pos * sizeof(Word));
+        pos++;
+        if (word_count - pos < edge_count)
+            error("Error in file format reading edges of node %u", i);
+        for (j = 0; j < edge_count; j++, pos++) {
+            n2 = DecodeWord(words + pos * sizeof(Word));
+            if (n2 >= node_count || n2 == i)
+                error("Error in file format reading edge %u %u", i, n2);
+            offset[i + 1]++;
+            if (undirected)
+                offset[n2 + 1]++;
+        }
+    }
+    if (pos != word_count)
+        error("Error in file format: %u trailing words", (uint32_t)(word_count - pos));
+
+    for (i = 0; i < node_count; i++)
+        offset[i + 1] += offset[i];
+    targets.resize(offset[node_count]);
+
+    // Second pass: scatter of the edges
+    {
+        std::vector<uint32_t> next(offset.begin(), offset.end() - 1);
+        pos = 1;
+        for (i = 0; i < node_count; i++) {
+            edge_count = DecodeWord(words + pos * sizeof(Word));
+            pos++;
+            for (j = 0; j < edge_count; j++, pos++) {
+                n2 = DecodeWord(words + pos * sizeof(Word));
+                targets[next[i]++] = n2;
+                if (undirected)
+                    targets[next[n2]++] = i;
+            }
+        }
+    }
+
+    // Sorting and removal of duplicated edges
+    w = 0;
+    for (i = 0; i < node_count; i++) {
+        std::vector<nodeID_t>::iterator begin = targets.begin() + offset[i];
+        std::vector<nodeID_t>::iterator end = targets.begin() + offset[i + 1];
+        std::sort(begin, end);
+        end = std::unique(begin, end);
+        offset[i] = (uint32_t)w;
+        for (; begin != end; begin++)
+            targets[w++] = *begin;
+    }
+    offset[node_count] = (uint32_t)w;
+    targets.resize(w);
+}
+
+template <typename Node, typename Edge, typename Word>
+uint32_t
+BinaryARGLoader<Node,Edge,Word>
+::NodeCount() const {
+    return node_count;
+}
+
+template <typename Node, typename Edge, typename Word>
+Node
+BinaryARGLoader<Node,Edge,Word>
+::GetNodeAttr(nodeID_t node) {
+    assert(node < node_count);
+    return Node();
+}
+
+template <typename Node, typename Edge, typename Word>
+uint32_t
+BinaryARGLoader<Node,Edge,Word>
+::OutEdgeCount(nodeID_t node) const {
+    assert(node < node_count);
+    return offset[node + 1] - offset[node];
+}
+
+template <typename Node, typename Edge, typename Word>
+nodeID_t
+BinaryARGLoader<Node,Edge,Word>
+::GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr) {
+    assert (i<OutEdgeCount(node));
+    *pattr = Edge();
+    return targets[offset[node] + i];
+}
+
+template <typename Node, typename Edge, typename Word>
+bool
+BinaryARGLoader<Node,Edge,Word>
+::ReleaseGraphData(ARGraphData<Node, Edge> &data) {
+    data.attr.assign(node_count, Node());
+    data.out_offset = std::move(offset);
+    data.out_nodes = std::move(targets);
+    if (EdgeAttrTraits<Edge>::stored)
+        data.out_attr.assign(data.out_nodes.size(), Edge());
+    node_count = 0;
+    offset.assign(1, 0);
+    targets.clear();
+    return true;
+}
+
+} // End namespace vflib
+
+#endif
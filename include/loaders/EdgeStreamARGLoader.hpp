@@ -7,21 +7,35 @@
  *        as a list of edges;
  *        no attributes are supported, so the loader always return
  *        the default value for the edge and node attribute type.
+ * @details The edges are appended as packed (u,v) pairs to a flat buffer,
+ *        that is radix sorted and deduplicated to obtain the adjacency
+ *        lists. When the buffer exceeds the memory limit it is sorted and
+ *        spilled to a temporary file as a run; the runs are then merged
+ *        while the adjacency lists are built, so that edge lists larger
+ *        than the memory can be loaded as long as the graph itself fits.
  */
 
 #ifndef EDGESTREAMARGLOADER_HPP
 #define EDGESTREAMARGLOADER_HPP
 
+#include <stdio.h>
 #include <iostream>
 #include <vector>
-#include <map>
+#include <queue>
+#include <algorithm>
+#include <functional>
 
 #include <Error.hpp>
 
 #include "ARGraph.hpp"
+#include "TextParsing.hpp"
 
 namespace vflib {
 
+const size_t EDGE_SORT_MEMORY_LIMIT = (size_t)1 << 30;  /**<Default memory for the edge buffer, in bytes */
+const size_t EDGE_READ_BLOCK_SIZE = 1 << 20;            /**<Size of the blocks read from the stream */
+const size_t EDGE_MERGE_BUFFER_SIZE = 1 << 16;          /**<Edges buffered for each run during the merge */
+
 template <typename Node, typename Edge>
 class EdgeStreamARGLoader: public ARGLoader<Node, Edge> {
     public:
@@ -31,67 +45,124 @@ class EdgeStreamARGLoader: public ARGLoader<Node, Edge> {
          * @param undirected If true, the graph is undirected
          * @param remove_isolated_nodes If true, the nodes that
          *        have no edges are removed from the graph
+         * @param memory_limit Memory in bytes for sorting the edges
+         *        before resorting to temporary files
          */
         EdgeStreamARGLoader(std::istream &in, bool undirected=false,
-                       bool remove_isolated_nodes=true);
+                       bool remove_isolated_nodes=true,
+                       size_t memory_limit=EDGE_SORT_MEMORY_LIMIT);
+        virtual ~EdgeStreamARGLoader();
         virtual uint32_t NodeCount() const;
         virtual Node GetNodeAttr(nodeID_t node);
         virtual uint32_t OutEdgeCount(nodeID_t node) const;
         virtual nodeID_t GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr);
+        virtual bool ReleaseGraphData(ARGraphData<Node, Edge> &data);
         void SetNodeAttribute(Node attr) { node_attribute=attr; }
         void SetEdgeAttribute(Edge attr) { edge_attribute=attr; }
 
     private:
+        /**
+         * @brief Sorted run of edges spilled to a temporary file
+         */
+        struct Run {
+            FILE *file;
+            uint64_t size;                  /**<edges in the run */
+            uint64_t read;                  /**<edges already read */
+            std::vector<uint64_t> buffer;
+            size_t pos;
+        };
+
         Node node_attribute;
         Edge edge_attribute;
         uint32_t node_count;
         std::vector<nodeID_t> forward, backward;
-        std::vector< std::map<nodeID_t, Empty> > edges;
-        typename std::map<nodeID_t, Empty>::iterator edge_iterator;
-        nodeID_t last_edge_node;
-        uint32_t last_edge_index;
+        std::vector<uint32_t> offset;       /**<start of the edges of each node in targets (node_count+1 entries) */
+        std::vector<nodeID_t> targets;      /**<end nodes of the edges, sorted for each node */
+        std::vector<uint64_t> pairs;        /**<edges read and not yet sorted, packed as (u << 32) | v */
+        std::vector<Run> runs;
+        size_t max_pairs;
+
         void skipHeading(std::istream &in);
+        void AddEdge(nodeID_t n1, nodeID_t n2, bool undirected);
+        void SortPairs();
+        void SpillPairs();
+        bool NextRunEdge(Run &run, uint64_t &edge);
+        template <typename Visitor>
+        void VisitSortedEdges(Visitor visit);
+        static void RadixSort(std::vector<uint64_t> &keys);
 };
 
 
-
 template <typename Node, typename Edge>
 EdgeStreamARGLoader<Node,Edge>
 ::EdgeStreamARGLoader(std::istream &in, bool undirected,
-                      bool remove_isolated_nodes) {
-    last_edge_node = NULL_NODE;
+                      bool remove_isolated_nodes, size_t memory_limit) {
     uint32_t count=0;
+    uint32_t i;
+
+    // The radix sort needs a second buffer as large as the first one
+    max_pairs = std::max<size_t>(memory_limit / (2 * sizeof(uint64_t)), 1024);
 
     if (!in.good())
       error("End of file or reading error");
 
     skipHeading(in);
-    nodeID_t n1, n2;
-    while (true) {
-        in >> n1 >> n2;
-        n1--;
-        n2--;
-        if (!in.good())
-            break;
-        if (n1 == n2)
-            error("File format error. Self edges are not allowed!", n1, n2);
-        if (n1>=count)
-            count = n1+1;
-        if (n2>=count)
-            count = n2+1;
-        edges.resize(count);
-        forward.resize(count, 0);
-        forward[n1]=1;
-        forward[n2]=1;
-        edges[n1][n2] = edge_attribute;
-        if (undirected)
-            edges[n2][n1] = edge_attribute;
+
+    std::vector<char> block(EDGE_READ_BLOCK_SIZE);
+    size_t filled = 0;
+    bool last_block = false;
+    while (!last_block) {
+        in.read(block.data() + filled, block.size() - filled);
+        filled += (size_t)in.gcount();
+        last_block = !in.good();
+
+        const char *p = block.data();
+        const char *end = p + filled;
+        const char *parse_end = end;
+        if (!last_block) {
+            // Only complete lines are parsed; the rest is moved ahead
+            while (parse_end > p && parse_end[-1] != '\n')
+                parse_end--;
+            if (parse_end == p) {
+                block.resize(block.size() * 2);
+                continue;
+            }
+        }
+
+        while (p < parse_end) {
+            const char *line_end = FindLineEnd(p, parse_end);
+            SkipBlanks(p, line_end);
+            if (p < line_end && *p != '#') {
+                nodeID_t n1, n2;
+                if (!ParseValue(p, line_end, n1) || !ParseValue(p, line_end, n2)
+                    || n1 == 0 || n2 == 0)
+                    error("File format error. Node ids must be positive integers!");
+                n1--;
+                n2--;
+                if (n1 == n2)
+                    error("File format error. Self edges are not allowed! %u %u", n1 + 1, n2 + 1);
+                if (n1>=count)
+                    count = n1+1;
+                if (n2>=count)
+                    count = n2+1;
+                if (forward.size() < count)
+                    forward.resize(std::max<size_t>(count, 2 * forward.size()), 0);
+                forward[n1]=1;
+                forward[n2]=1;
+                AddEdge(n1, n2, undirected);
+            }
+            p = line_end + 1;
+        }
+
+        filled = end - parse_end;
+        std::copy(parse_end, end, block.begin());
     }
+    forward.resize(count);
 
     if (remove_isolated_nodes) {
         backward.reserve(count);
         node_count=0;
-        for(uint32_t i=0; i<count; i++) {
+        for(i=0; i<count; i++) {
             if (forward[i]>0) {
                 forward[i]=node_count ++;
                 backward.push_back(i);
@@ -100,11 +171,168 @@ EdgeStreamARGLoader<Node,Edge>
     } else {
         node_count=count;
         backward.resize(count);
-        for(uint32_t i=0; i<count; i++) {
+        for(i=0; i<count; i++) {
             forward[i]=i;
             backward[i]=i;
         }
     }
+
+    // The renumbering keeps the order of the nodes, so the sorted
+    // edges give the adjacency lists already sorted
+    offset.assign(node_count + 1, 0);
+    VisitSortedEdges([&](uint64_t edge) {
+        offset[forward[(nodeID_t)(edge >> 32)] + 1]++;
+        targets.push_back(forward[(nodeID_t)edge]);
+    });
+    for (i = 0; i < node_count; i++)
+        offset[i + 1] += offset[i];
+}
+
+template <typename Node, typename Edge>
+EdgeStreamARGLoader<Node,Edge>
+::~EdgeStreamARGLoader() {
+    for (size_t r = 0; r < runs.size(); r++)
+        if (runs[r].file)
+            fclose(runs[r].file);
+}
+
+template <typename Node, typename Edge>
+void
+EdgeStreamARGLoader<Node,Edge>
+::AddEdge(nodeID_t n1, nodeID_t n2, bool undirected) {
+    if (pairs.size() + 2 > max_pairs)
+        SpillPairs();
+    pairs.push_back(((uint64_t)n1 << 32) | n2);
+    if (undirected)
+        pairs.push_back(((uint64_t)n2 << 32) | n1);
+}
+
+/**
+ * @brief LSD radix sort on 16-bit digits; digits shared by all the keys are skipped
+ */
+template <typename Node, typename Edge>
+void
+EdgeStreamARGLoader<Node,Edge>
+::RadixSort(std::vector<uint64_t> &keys) {
+    const uint32_t digits = 1 << 16;
+    std::vector<uint64_t> sorted(keys.size());
+    std::vector<size_t> position(digits);
+    size_t k;
+
+    for (uint32_t shift = 0; shift < 64; shift += 16) {
+        std::fill(position.begin(), position.end(), 0);
+        for (k = 0; k < keys.size(); k++)
+            position[(keys[k] >> shift) & (digits - 1)]++;
+        if (keys.empty() || position[(keys[0] >> shift) & (digits - 1)] == keys.size())
+            continue;
+
+        size_t sum = 0;
+        for (uint32_t d = 0; d < digits; d++) {
+            size_t c = position[d];
+            position[d] = sum;
+            sum += c;
+        }
+        for (k = 0; k < keys.size(); k++)
+            sorted[position[(keys[k] >> shift) & (digits - 1)]++] = keys[k];
+        keys.swap(sorted);
+    }
+}
+
+template <typename Node, typename Edge>
+void
+EdgeStreamARGLoader<Node,Edge>
+::SortPairs() {
+    RadixSort(pairs);
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
+
+/**
+ * @brief Sorts the buffered edges and writes them to a temporary file
+ */
+template <typename Node, typename Edge>
+void
+EdgeStreamARGLoader<Node,Edge>
+::SpillPairs() {
+    Run run;
+
+    SortPairs();
+    run.file = tmpfile();
+    if (!run.file || fwrite(pairs.data(), sizeof(uint64_t), pairs.size(), run.file) != pairs.size())
+        error("Unable to write temporary file for sorting edges");
+    rewind(run.file);
+    run.size = pairs.size();
+    run.read = 0;
+    run.pos = 0;
+    runs.push_back(run);
+    pairs.clear();
+}
+
+template <typename Node, typename Edge>
+bool
+EdgeStreamARGLoader<Node,Edge>
+::NextRunEdge(Run &run, uint64_t &edge) {
+    if (run.pos == run.buffer.size()) {
+        if (run.read == run.size)
+            return false;
+        size_t n = (size_t)std::min<uint64_t>(EDGE_MERGE_BUFFER_SIZE, run.size - run.read);
+        run.buffer.resize(n);
+        if (fread(run.buffer.data(), sizeof(uint64_t), n, run.file) != n)
+            error("Unable to read temporary file for sorting edges");
+        run.read += n;
+        run.pos = 0;
+    }
+    edge = run.buffer[run.pos++];
+    return true;
+}
+
+/**
+ * @brief Visits all the edges read, sorted and without duplicates,
+ *        merging the runs spilled to temporary files if any
+ */
+template <typename Node, typename Edge>
+template <typename Visitor>
+void
+EdgeStreamARGLoader<Node,Edge>
+::VisitSortedEdges(Visitor visit) {
+    size_t k;
+
+    if (runs.empty()) {
+        SortPairs();
+        targets.reserve(pairs.size());
+        for (k = 0; k < pairs.size(); k++)
+            visit(pairs[k]);
+        std::vector<uint64_t>().swap(pairs);
+        return;
+    }
+
+    if (!pairs.empty())
+        SpillPairs();
+    std::vector<uint64_t>().swap(pairs);
+
+    typedef std::pair<uint64_t, size_t> Head;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head> > heads;
+    uint64_t edge, last = 0;
+    bool first = true;
+
+    for (k = 0; k < runs.size(); k++)
+        if (NextRunEdge(runs[k], edge))
+            heads.push(Head(edge, k));
+    while (!heads.empty()) {
+        Head head = heads.top();
+        heads.pop();
+        if (first || head.first != last)
+            visit(head.first);
+        first = false;
+        last = head.first;
+        if (NextRunEdge(runs[head.second], edge))
+            heads.push(Head(edge, head.second));
+    }
+
+    for (k = 0; k < runs.size(); k++) {
+        fclose(runs[k].file);
+        runs[k].file = NULL;
+    }
+    runs.clear();
 }
 
 template <typename Node, typename Edge>
@@ -125,7 +353,7 @@ template <typename Node, typename Edge>
 uint32_t
 EdgeStreamARGLoader<Node,Edge>
 ::OutEdgeCount(nodeID_t node) const {
-    return edges[backward[node]].size();
+    return offset[node + 1] - offset[node];
 }
 
 template <typename Node, typename Edge>
@@ -134,23 +362,8 @@ EdgeStreamARGLoader<Node,Edge>
 ::GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr) {
     assert (i<OutEdgeCount(node));
 
-    if (node != last_edge_node) {
-        last_edge_node = node;
-        edge_iterator = edges[backward[node]].begin();
-        last_edge_index = 0;
-    }
-    while (last_edge_index < i) {
-        edge_iterator ++;
-        last_edge_index ++;
-    }
-
-    while (last_edge_index > i) {
-        edge_iterator --;
-        last_edge_index --;
-    }
-
     *pattr = edge_attribute;
-    return forward[edge_iterator->first];
+    return targets[offset[node] + i];
 }
 
 
@@ -168,6 +381,21 @@ EdgeStreamARGLoader<Node,Edge>
     }
 }
 
+template <typename Node, typename Edge>
+bool
+EdgeStreamARGLoader<Node,Edge>
+::ReleaseGraphData(ARGraphData<Node, Edge> &data) {
+    data.attr.assign(node_count, node_attribute);
+    data.out_offset = std::move(offset);
+    data.out_nodes = std::move(targets);
+    if (EdgeAttrTraits<Edge>::stored)
+        data.out_attr.assign(data.out_nodes.size(), edge_attribute);
+    node_count = 0;
+    offset.assign(1, 0);
+    targets.clear();
+    return true;
+}
+
 } // End namespace vflib
 
 #endif
@@ -32,6 +32,7 @@ class FastStreamARGLoader: public ARGLoader<Node, Edge> {
         virtual Node GetNodeAttr(nodeID_t node);
         virtual uint32_t OutEdgeCount(nodeID_t node) const;
         virtual nodeID_t GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr);
+        virtual bool ReleaseGraphData(ARGraphData<Node, Edge> &data);
 
     private:
         uint32_t node_count;
@@ -130,6 +131,44 @@ FastStreamARGLoader<Node,Edge>
     return edge_iterator->first;
 }
 
+/**
+ * @brief Moves the graph out of the loader, walking each edge map
+ *        once instead of stepping its iterator for every edge
+ */
+template <typename Node, typename Edge>
+bool
+FastStreamARGLoader<Node,Edge>
+::ReleaseGraphData(ARGraphData<Node, Edge> &data) {
+    nodeID_t i;
+    uint32_t edge_count = 0;
+
+    data.out_offset.resize(node_count + 1);
+    for(i=0; i<node_count; i++) {
+        data.out_offset[i] = edge_count;
+        edge_count += edges[i].size();
+    }
+    data.out_offset[node_count] = edge_count;
+
+    data.out_nodes.reserve(edge_count);
+    if (EdgeAttrTraits<Edge>::stored)
+        data.out_attr.reserve(edge_count);
+    for(i=0; i<node_count; i++) {
+        typename std::map<nodeID_t, Edge>::iterator it;
+        for(it=edges[i].begin(); it!=edges[i].end(); it++) {
+            data.out_nodes.push_back(it->first);
+            if (EdgeAttrTraits<Edge>::stored)
+                data.out_attr.push_back(it->second);
+        }
+        std::map<nodeID_t, Edge>().swap(edges[i]);
+    }
+    data.attr = std::move(nodes);
+
+    node_count = 0;
+    nodes.clear();
+    edges.clear();
+    last_edge_node = NULL_NODE;
+    return true;
+}
 
 
 } // End namespace vflib
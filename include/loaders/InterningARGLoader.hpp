@@ -0,0 +1,104 @@
+/**
+ * @file InterningARGLoader.hpp
+ * @brief An ARGLoader replacing the node labels read by another loader
+ *        with their integer ids in a LabelDictionary
+ * @details The labels are interned once at load time; the graph built
+ *        from this loader, and everything working on it, only sees
+ *        uint32_t node attributes.
+ */
+
+#ifndef INTERNINGARGLOADER_HPP
+#define INTERNINGARGLOADER_HPP
+
+#include <vector>
+
+#include "ARGraph.hpp"
+#include "LabelDictionary.hpp"
+
+namespace vflib {
+
+template <typename Label, typename Edge>
+class InterningARGLoader: public ARGLoader<uint32_t, Edge> {
+    public:
+        /**
+         * @brief Interns the node labels of a loader
+         * @param loader The loader of the graph, still owned by the caller
+         * @param labels The dictionary shared by the graphs to be matched
+         */
+        InterningARGLoader(ARGLoader<Label, Edge> *loader, LabelDictionary<Label> &labels);
+        virtual uint32_t NodeCount() const;
+        virtual uint32_t GetNodeAttr(nodeID_t node);
+        virtual uint32_t OutEdgeCount(nodeID_t node) const;
+        virtual nodeID_t GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr);
+        virtual bool ReleaseGraphData(ARGraphData<uint32_t, Edge> &data);
+
+    private:
+        ARGLoader<Label, Edge> *loader;
+        LabelDictionary<Label> &labels;
+        std::vector<uint32_t> ids;      /**<interned label of each node */
+};
+
+template <typename Label, typename Edge>
+InterningARGLoader<Label,Edge>
+::InterningARGLoader(ARGLoader<Label, Edge> *loader, LabelDictionary<Label> &labels):
+    loader(loader), labels(labels) {
+    uint32_t count = loader->NodeCount();
+    ids.resize(count);
+    for (nodeID_t i = 0; i < count; i++)
+        ids[i] = labels.Intern(loader->GetNodeAttr(i));
+}
+
+template <typename Label, typename Edge>
+uint32_t
+InterningARGLoader<Label,Edge>
+::NodeCount() const {
+    return (uint32_t)ids.size();
+}
+
+template <typename Label, typename Edge>
+uint32_t
+InterningARGLoader<Label,Edge>
+::GetNodeAttr(nodeID_t node) {
+    return ids[node];
+}
+
+template <typename Label, typename Edge>
+uint32_t
+InterningARGLoader<Label,Edge>
+::OutEdgeCount(nodeID_t node) const {
+    return loader->OutEdgeCount(node);
+}
+
+template <typename Label, typename Edge>
+nodeID_t
+InterningARGLoader<Label,Edge>
+::GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr) {
+    return loader->GetOutEdge(node, i, pattr);
+}
+
+/**
+ * @brief Moves the edge arrays of the wrapped loader, if it can release
+ *        them, next to the interned labels
+ */
+template <typename Label, typename Edge>
+bool
+InterningARGLoader<Label,Edge>
+::ReleaseGraphData(ARGraphData<uint32_t, Edge> &data) {
+    ARGraphData<Label, Edge> source;
+    if (!loader->ReleaseGraphData(source))
+        return false;
+
+    data.attr = std::move(ids);
+    data.in_offset = std::move(source.in_offset);
+    data.out_offset = std::move(source.out_offset);
+    data.in_nodes = std::move(source.in_nodes);
+    data.out_nodes = std::move(source.out_nodes);
+    data.in_attr = std::move(source.in_attr);
+    data.out_attr = std::move(source.out_attr);
+    ids.clear();
+    return true;
+}
+
+} // End namespace vflib
+
+#endif
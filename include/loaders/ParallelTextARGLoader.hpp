@@ -0,0 +1,410 @@
+/**
+ * @file ParallelTextARGLoader.hpp
+ * @brief A multithreaded implementation of the ARGLoader interface for
+ *        reading the VF text format from a memory mapped file
+ * @details The file is mapped in memory. The header and the node section
+ *        are parsed sequentially, while the edge section is split in
+ *        chunks at line boundaries that are parsed by different threads.
+ *        The edges are then validated and gathered in flat arrays, sorted
+ *        by end node for each node, again in parallel.
+ *
+ *        The edge section is parsed line by line: a line holding a single
+ *        value is the number of edges of the next node, any other line is
+ *        an edge. As in FastStreamARGLoader, an edge listed twice keeps
+ *        the attribute of its last occurrence.
+ */
+
+#ifndef PARALLELTEXTARGLOADER_HPP
+#define PARALLELTEXTARGLOADER_HPP
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+#include <cstdarg>
+
+#include <Error.hpp>
+
+#include "ARGraph.hpp"
+#include "MappedFile.hpp"
+#include "TextParsing.hpp"
+
+namespace vflib {
+
+const size_t PARSE_MIN_CHUNK_SIZE = 1 << 20;   /**<Min size in bytes of the chunk parsed by a thread */
+
+template <typename Node, typename Edge>
+class ParallelTextARGLoader: public ARGLoader<Node, Edge> {
+    public:
+        /**
+         * @brief Reads the graph data from a text file
+         * @param filename Name of the file
+         * @param undirected If true, the graph is undirected
+         * @param threads Number of threads, 0 to use all the available cores
+         */
+        ParallelTextARGLoader(const std::string &filename, bool undirected=false,
+            uint32_t threads=0);
+        virtual uint32_t NodeCount() const;
+        virtual Node GetNodeAttr(nodeID_t node);
+        virtual uint32_t OutEdgeCount(nodeID_t node) const;
+        virtual nodeID_t GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr);
+        virtual bool ReleaseGraphData(ARGraphData<Node, Edge> &data);
+
+    private:
+        /**
+         * @brief Part of the edge section parsed by a thread
+         */
+        struct Chunk {
+            const char *begin;
+            const char *end;
+            std::vector<uint32_t> counts;       /**<edge counts found in the chunk, in order */
+            std::vector<uint32_t> group_edges;  /**<edges before the first count, then after each count */
+            std::vector<nodeID_t> src;
+            std::vector<nodeID_t> dst;
+            std::vector<Edge> attr;
+            nodeID_t first_node;                /**<node of the edges before the first count */
+            uint32_t first_edge;                /**<index of the first edge of the chunk in the file */
+            std::string error;                  /**<first error found in the chunk, empty if none */
+        };
+
+        /**
+         * @brief Edge of a node being sorted: end node and index of the edge in the file
+         */
+        typedef std::pair<nodeID_t, uint32_t> EdgeEntry;
+
+        uint32_t node_count;
+        uint32_t thread_count;
+        std::vector<Node> nodes;
+        std::vector<uint32_t> offset;   /**<start of the edges of each node in targets (node_count+1 entries) */
+        std::vector<nodeID_t> targets;  /**<end nodes of the edges, sorted for each node */
+        std::vector<Edge> edge_attr;    /**<attributes of the edges, parallel to targets */
+
+        template <typename Function>
+        void RunParallel(uint32_t tasks, Function f);
+        static void ParseChunk(Chunk &chunk);
+        void ValidateChunk(Chunk &chunk, const std::vector<uint32_t> &node_offset) const;
+        static void SetChunkError(Chunk &chunk, const char *format, ...);
+        static void CheckChunks(const std::vector<Chunk> &chunks);
+};
+
+/**
+ * @brief Runs a task for each index in [0, tasks), on up to thread_count threads
+ */
+template <typename Node, typename Edge>
+template <typename Function>
+void
+ParallelTextARGLoader<Node,Edge>
+::RunParallel(uint32_t tasks, Function f) {
+    std::vector<std::thread> pool;
+    uint32_t t;
+    uint32_t workers = std::min(tasks, thread_count);
+
+    for (t = 1; t < workers; t++)
+        pool.push_back(std::thread([=]() {
+            for (uint32_t i = t; i < tasks; i += workers)
+                f(i);
+        }));
+    for (t = 0; t < tasks; t += (workers ? workers : 1))
+        f(t);
+    for (t = 0; t < pool.size(); t++)
+        pool[t].join();
+}
+
+/**
+ * @brief Records the error of a chunk, in the same syntax of error()
+ * @details The workers can't call error(), that exits while the other
+ *        threads are running: the error is reported by CheckChunks once
+ *        they are all joined.
+ */
+template <typename Node, typename Edge>
+void
+ParallelTextARGLoader<Node,Edge>
+::SetChunkError(Chunk &chunk, const char *format, ...) {
+    char msg[256];
+    va_list ap;
+
+    va_start(ap, format);
+    vsnprintf(msg, sizeof(msg), format, ap);
+    va_end(ap);
+    chunk.error = msg;
+}
+
+/**
+ * @brief Reports the error of the first chunk that failed, if any
+ * @details The chunks follow the order of the file, so the error reported
+ *        is the first one of the file whatever thread found it.
+ */
+template <typename Node, typename Edge>
+void
+ParallelTextARGLoader<Node,Edge>
+::CheckChunks(const std::vector<Chunk> &chunks) {
+    for (size_t c = 0; c < chunks.size(); c++)
+        if (!chunks[c].error.empty())
+            error("%s", chunks[c].error.c_str());
+}
+
+/**
+ * @brief Reads the counts and the edges of a chunk, up to its first error
+ */
+template <typename Node, typename Edge>
+void
+ParallelTextARGLoader<Node,Edge>
+::ParseChunk(Chunk &chunk) {
+    const char *p = chunk.begin;
+    nodeID_t n1, n2;
+    Edge attr;
+
+    chunk.group_edges.push_back(0);
+    while (p < chunk.end) {
+        const char *line_end = FindLineEnd(p, chunk.end);
+        SkipBlanks(p, line_end);
+        if (p < line_end) {
+            if (!ParseValue(p, line_end, n1)) {
+                SetChunkError(chunk, "Error in file format reading edges");
+                return;
+            }
+            SkipBlanks(p, line_end);
+            if (p == line_end) {
+                chunk.counts.push_back(n1);
+                chunk.group_edges.push_back(0);
+            }
+            else {
+                if (!ParseValue(p, line_end, n2) || !ParseValue(p, line_end, attr)) {
+                    SetChunkError(chunk, "Error in file format reading edge %u", n1);
+                    return;
+                }
+                chunk.src.push_back(n1);
+                chunk.dst.push_back(n2);
+                chunk.attr.push_back(attr);
+                chunk.group_edges.back()++;
+            }
+        }
+        p = line_end + 1;
+    }
+}
+
+/**
+ * @brief Checks that the edges of a chunk belong to the node of the last
+ *        count read and that the counts match the edges.
+ */
+template <typename Node, typename Edge>
+void
+ParallelTextARGLoader<Node,Edge>
+::ValidateChunk(Chunk &chunk, const std::vector<uint32_t> &node_offset) const {
+    uint32_t g, e = 0, k;
+    nodeID_t node = chunk.first_node;
+
+    for (g = 0; g < chunk.group_edges.size(); g++, node++) {
+        for (k = 0; k < chunk.group_edges[g]; k++, e++) {
+            nodeID_t n1 = chunk.src[e];
+            nodeID_t n2 = chunk.dst[e];
+            uint32_t index = chunk.first_edge + e;
+            if (node >= node_count || n1 != node || n2 >= node_count || n1 == n2 ||
+                index < node_offset[node] || index >= node_offset[node + 1]) {
+                SetChunkError(chunk, "Error in file format reading edge %u %u", n1, n2);
+                return;
+            }
+        }
+    }
+}
+
+template <typename Node, typename Edge>
+ParallelTextARGLoader<Node,Edge>
+::ParallelTextARGLoader(const std::string &filename, bool undirected, uint32_t threads) {
+    MappedFile file(filename);
+    const char *p = file.Data();
+    const char *end = p + file.Size();
+    nodeID_t i, n1;
+    uint32_t c;
+
+    thread_count = threads ? threads : std::thread::hardware_concurrency();
+    if (!thread_count)
+        thread_count = 1;
+
+    if (!p)
+        error("End of file or reading error");
+
+    // Ignoring lines starting with '#'
+    while (p < end && *p == '#')
+        p = FindLineEnd(p, end) + 1;
+
+    SkipSpaces(p, end);
+    if (p >= end || !ParseValue(p, end, node_count))
+        error("End of file or reading error");
+    nodes.resize(node_count);
+    for (i = 0; i < node_count; i++) {
+        SkipSpaces(p, end);
+        if (!ParseValue(p, end, n1) || n1 != i)
+            error("Error in file format reading node %u", i);
+        SkipSpaces(p, end);
+        if (!ParseValue(p, end, nodes[i]))
+            error("Error in file format reading node %u", i);
+    }
+    if (p < end)
+        p = FindLineEnd(p, end) + 1;
+    if (p > end)
+        p = end;
+
+    // Splitting of the edge section at line boundaries
+    size_t size = end - p;
+    uint32_t chunk_count = (uint32_t)std::min<size_t>(thread_count, size / PARSE_MIN_CHUNK_SIZE + 1);
+    std::vector<Chunk> chunks(chunk_count);
+    for (c = 0; c < chunk_count; c++) {
+        chunks[c].begin = c ? chunks[c - 1].end : p;
+        if (c + 1 == chunk_count)
+            chunks[c].end = end;
+        else {
+            const char *split = std::max(chunks[c].begin, p + size / chunk_count * (c + 1));
+            chunks[c].end = split < end ? std::min(FindLineEnd(split, end) + 1, end) : end;
+        }
+    }
+
+    RunParallel(chunk_count, [&](uint32_t t) { ParseChunk(chunks[t]); });
+    CheckChunks(chunks);
+
+    // Node of the first edges of each chunk and edge counts of the nodes
+    std::vector<uint32_t> node_offset(node_count + 1, 0);
+    uint32_t counts_read = 0, edges_read = 0;
+    for (c = 0; c < chunk_count; c++) {
+        chunks[c].first_node = counts_read - 1;
+        chunks[c].first_edge = edges_read;
+        for (i = 0; i < chunks[c].counts.size(); i++) {
+            if (counts_read + i >= node_count)
+                error("Error in file format: too many nodes in the edge section");
+            node_offset[counts_read + i + 1] = chunks[c].counts[i];
+        }
+        counts_read += chunks[c].counts.size();
+        edges_read += chunks[c].src.size();
+    }
+    if (counts_read != node_count)
+        error("Error in file format: missing edges of node %u", counts_read);
+    for (i = 0; i < node_count; i++)
+        node_offset[i + 1] += node_offset[i];
+    if (node_offset[node_count] != edges_read)
+        error("Error in file format: wrong number of edges");
+
+    // Validation and gathering of the edges of each node
+    uint32_t edge_count = undirected ? 2 * edges_read : edges_read;
+    std::vector<EdgeEntry> entries(edge_count);
+    std::vector<Edge> file_attr(edges_read);
+    std::vector<uint32_t> entry_offset;
+    RunParallel(chunk_count, [&](uint32_t t) {
+        Chunk &chunk = chunks[t];
+        ValidateChunk(chunk, node_offset);
+        if (!chunk.error.empty())
+            return;
+        std::copy(chunk.attr.begin(), chunk.attr.end(), file_attr.begin() + chunk.first_edge);
+        if (!undirected)
+            for (uint32_t e = 0; e < chunk.src.size(); e++)
+                entries[chunk.first_edge + e] = EdgeEntry(chunk.dst[e], chunk.first_edge + e);
+    });
+    CheckChunks(chunks);
+
+    if (!undirected)
+        entry_offset.swap(node_offset);
+    else {
+        entry_offset.assign(node_count + 1, 0);
+        for (c = 0; c < chunk_count; c++)
+            for (uint32_t e = 0; e < chunks[c].src.size(); e++) {
+                entry_offset[chunks[c].src[e] + 1]++;
+                entry_offset[chunks[c].dst[e] + 1]++;
+            }
+        for (i = 0; i < node_count; i++)
+            entry_offset[i + 1] += entry_offset[i];
+        std::vector<uint32_t> next(entry_offset.begin(), entry_offset.end() - 1);
+        for (c = 0; c < chunk_count; c++)
+            for (uint32_t e = 0; e < chunks[c].src.size(); e++) {
+                uint32_t index = chunks[c].first_edge + e;
+                entries[next[chunks[c].src[e]]++] = EdgeEntry(chunks[c].dst[e], index);
+                entries[next[chunks[c].dst[e]]++] = EdgeEntry(chunks[c].src[e], index);
+            }
+    }
+    std::vector<Chunk>().swap(chunks);
+
+    // Sorting of each node, keeping the last occurrence of repeated edges
+    uint32_t range_count = std::min<uint32_t>(thread_count, node_count ? node_count : 1);
+    std::vector<uint32_t> degree(node_count);
+    RunParallel(range_count, [&](uint32_t t) {
+        nodeID_t first = (nodeID_t)((uint64_t)node_count * t / range_count);
+        nodeID_t last = (nodeID_t)((uint64_t)node_count * (t + 1) / range_count);
+        for (nodeID_t node = first; node < last; node++) {
+            EdgeEntry *row = entries.data() + entry_offset[node];
+            uint32_t k = entry_offset[node + 1] - entry_offset[node];
+            uint32_t j, w = 0;
+            std::sort(row, row + k);
+            for (j = 0; j < k; j++) {
+                if (j + 1 < k && row[j + 1].first == row[j].first)
+                    continue;
+                row[w++] = row[j];
+            }
+            degree[node] = w;
+        }
+    });
+
+    offset.assign(node_count + 1, 0);
+    for (i = 0; i < node_count; i++)
+        offset[i + 1] = offset[i] + degree[i];
+    targets.resize(offset[node_count]);
+    edge_attr.resize(offset[node_count]);
+    RunParallel(range_count, [&](uint32_t t) {
+        nodeID_t first = (nodeID_t)((uint64_t)node_count * t / range_count);
+        nodeID_t last = (nodeID_t)((uint64_t)node_count * (t + 1) / range_count);
+        for (nodeID_t node = first; node < last; node++)
+            for (uint32_t j = 0; j < degree[node]; j++) {
+                const EdgeEntry &entry = entries[entry_offset[node] + j];
+                targets[offset[node] + j] = entry.first;
+                edge_attr[offset[node] + j] = file_attr[entry.second];
+            }
+    });
+}
+
+template <typename Node, typename Edge>
+uint32_t
+ParallelTextARGLoader<Node,Edge>
+::NodeCount() const {
+    return node_count;
+}
+
+template <typename Node, typename Edge>
+Node
+ParallelTextARGLoader<Node,Edge>
+::GetNodeAttr(nodeID_t node) {
+    return nodes[node];
+}
+
+template <typename Node, typename Edge>
+uint32_t
+ParallelTextARGLoader<Node,Edge>
+::OutEdgeCount(nodeID_t node) const {
+    return offset[node + 1] - offset[node];
+}
+
+template <typename Node, typename Edge>
+nodeID_t
+ParallelTextARGLoader<Node,Edge>
+::GetOutEdge(nodeID_t node, uint32_t i, Edge *pattr) {
+    assert (i<OutEdgeCount(node));
+    *pattr = edge_attr[offset[node] + i];
+    return targets[offset[node] + i];
+}
+
+template <typename Node, typename Edge>
+bool
+ParallelTextARGLoader<Node,Edge>
+::ReleaseGraphData(ARGraphData<Node, Edge> &data) {
+    data.attr = std::move(nodes);
+    data.out_offset = std::move(offset);
+    data.out_nodes = std::move(targets);
+    if (EdgeAttrTraits<Edge>::stored)
+        data.out_attr = std::move(edge_attr);
+    edge_attr.clear();
+    node_count = 0;
+    nodes.clear();
+    offset.assign(1, 0);
+    return true;
+}
+
+} // End namespace vflib
+
+#endif
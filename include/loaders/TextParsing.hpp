@@ -0,0 +1,116 @@
+/**
+ * @file TextParsing.hpp
+ * @brief Helpers for the loaders parsing text graph files from memory
+ * @details Values are parsed from a [p, end) character range, advancing p.
+ *        Integers are parsed by hand, since they are the bulk of any graph
+ *        file; other attribute types fall back to operator>>.
+ *        Blanks are spaces, tabs and carriage returns: line feeds are left
+ *        to the caller, so that the files can be parsed line by line.
+ */
+
+#ifndef TEXTPARSING_HPP
+#define TEXTPARSING_HPP
+
+#include <string.h>
+#include <string>
+#include <sstream>
+#include <type_traits>
+
+#include "ARGraph.hpp"
+
+namespace vflib {
+
+inline bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief Skips blanks, stopping at the end of the line
+ */
+inline void SkipBlanks(const char *&p, const char *end) {
+    while (p < end && IsBlank(*p))
+        p++;
+}
+
+/**
+ * @brief Skips blanks and line feeds
+ */
+inline void SkipSpaces(const char *&p, const char *end) {
+    while (p < end && (IsBlank(*p) || *p == '\n'))
+        p++;
+}
+
+/**
+ * @brief Returns the end of the line starting at p (the line feed or end)
+ */
+inline const char* FindLineEnd(const char *p, const char *end) {
+    const char *lf = (const char*)memchr(p, '\n', end - p);
+    return lf ? lf : end;
+}
+
+/**
+ * @brief Returns the end of the token starting at p
+ */
+inline const char* FindTokenEnd(const char *p, const char *end) {
+    while (p < end && !IsBlank(*p) && *p != '\n')
+        p++;
+    return p;
+}
+
+/**
+ * @brief Parses an integer value
+ * @returns False if there are no digits at p
+ */
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value, bool>::type
+ParseValue(const char *&p, const char *end, T &value) {
+    bool negative = false;
+    T v = 0;
+
+    SkipBlanks(p, end);
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p >= end || *p < '0' || *p > '9')
+        return false;
+    while (p < end && *p >= '0' && *p <= '9')
+        v = v * 10 + (T)(*p++ - '0');
+    value = negative ? (T)(0 - v) : v;
+    return p >= end || IsBlank(*p) || *p == '\n';
+}
+
+/**
+ * @brief Parses an empty attribute, which takes no characters
+ */
+inline bool ParseValue(const char *&/*p*/, const char */*end*/, Empty &/*value*/) {
+    return true;
+}
+
+/**
+ * @brief Parses a string attribute made of one token
+ */
+inline bool ParseValue(const char *&p, const char *end, std::string &value) {
+    SkipBlanks(p, end);
+    const char *token_end = FindTokenEnd(p, end);
+    value.assign(p, token_end);
+    p = token_end;
+    return !value.empty();
+}
+
+/**
+ * @brief Parses a value of any other type with its operator>>
+ */
+template <typename T>
+inline typename std::enable_if<!std::is_integral<T>::value, bool>::type
+ParseValue(const char *&p, const char *end, T &value) {
+    SkipBlanks(p, end);
+    const char *token_end = FindTokenEnd(p, end);
+    std::istringstream token(std::string(p, token_end));
+    p = token_end;
+    return (bool)(token >> value);
+}
+
+} // End namespace vflib
+
+#endif
@@ -12,7 +12,10 @@
 #include <cstring>
 #include <iostream>
 #include <vector>
+#include <memory>
 #include "ARGraph.hpp"
+#include "NeighborSignatures.hpp"
+#include "ClassNodeIndex.hpp"
 
 typedef unsigned char node_dir_t;
 #define NODE_DIR_NONE 0
@@ -72,6 +75,8 @@ private:
   uint32_t *class_1;       //Classes for nodes of the first graph
   uint32_t *class_2;       //Classes for nodes of the first graph
   uint32_t classes_count;  //Number of classes
+  std::shared_ptr<const ClassNodeIndex> class_nodes;  //Nodes of the second graph by class
+  const NeighborSignatures *signatures;  //Neighbor classes of the nodes, NULL if not used
 
   int64_t *share_count;
 
@@ -90,6 +95,8 @@ public:
   ~CloneableVF3ParallelSubState();
   ARGraph<Node1, Edge1> *GetGraph1() { return g1; }
   ARGraph<Node2, Edge2> *GetGraph2() { return g2; }
+  //The signatures are shared by all the states and must outlive them
+  void SetNeighborSignatures(const NeighborSignatures *s) { signatures = s; }
   bool NextPair(nodeID_t *pn1, nodeID_t *pn2, nodeID_t prev_n1=NULL_NODE, nodeID_t prev_n2=NULL_NODE);
   bool IsFeasiblePair(nodeID_t n1, nodeID_t n2);
   void AddPair(nodeID_t n1, nodeID_t n2);
@@ -144,6 +151,8 @@ CloneableVF3ParallelSubState<Node1,Node2,Edge1,Edge2,NodeComparisonFunctor,EdgeC
   this->class_1 = class_1;
   this->class_2 = class_2;
   this->classes_count = nclass;
+  class_nodes = std::make_shared<ClassNodeIndex>(class_2, n2, nclass);
+  signatures = NULL;
   core_len=orig_core_len=0;
   this->edgeInduced = edgeInduced;
 
@@ -203,6 +212,8 @@ CloneableVF3ParallelSubState<Node1,Node2,Edge1,Edge2,NodeComparisonFunctor,EdgeC
   class_1 = state.class_1;
   class_2 = state.class_2;
   classes_count = state.classes_count;
+  class_nodes = state.class_nodes;
+  signatures = state.signatures;
   last_candidate_index = state.last_candidate_index;
   core_len=orig_core_len=state.core_len;
   added_node1=NULL_NODE;
@@ -323,55 +334,60 @@ bool CloneableVF3ParallelSubState<Node1,Node2,Edge1,Edge2,NodeComparisonFunctor,
     }
 
     pred_pair = (*core_1)[predecessors[curr_n1]];
+    const nodeID_t *candidates = NULL;
     switch (dir[curr_n1])
       {
         case NODE_DIR_IN:
-        pred_set_size = g2->InEdgeCount(pred_pair);
-
-        while(last_candidate_index < pred_set_size)
+        if(g2->HasClassIndex(class_2))
+          candidates = g2->GetInEdgesOfClass(pred_pair, c, pred_set_size);
+        else
           {
-            prev_n2 = g2->GetInEdge(pred_pair,last_candidate_index);
-            if((*core_2)[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
-              last_candidate_index++;
-            else
-              break;
+            candidates = g2->GetInEdgeSet(pred_pair);
+            pred_set_size = g2->InEdgeCount(pred_pair);
           }
-
         break;
 
         case NODE_DIR_OUT:
-        pred_set_size = g2->OutEdgeCount(pred_pair);
-
-        while(last_candidate_index < pred_set_size)
+        if(g2->HasClassIndex(class_2))
+          candidates = g2->GetOutEdgesOfClass(pred_pair, c, pred_set_size);
+        else
           {
-            prev_n2 = g2->GetOutEdge(pred_pair,last_candidate_index);
-            if((*core_2)[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
-              last_candidate_index++;
-            else
-              break;
+            candidates = g2->GetOutEdgeSet(pred_pair);
+            pred_set_size = g2->OutEdgeCount(pred_pair);
           }
-
         break;
       }
 
+    while(last_candidate_index < pred_set_size)
+      {
+        prev_n2 = candidates[last_candidate_index];
+        if((*core_2)[prev_n2] != NULL_NODE || class_2[prev_n2] != c)
+          last_candidate_index++;
+        else
+          break;
+      }
+
     if(last_candidate_index >= pred_set_size)
       return false;
 
     }
   else
     {
-    //Recupero il nodo dell'esterno
+    //Without a predecessor only the nodes of its class are scanned
     if(prev_n2 == NULL_NODE)
-      prev_n2 = 0;
+      last_candidate_index = 0;
     else
-      prev_n2++;
+      last_candidate_index++;
 
-    while (prev_n2<n2 &&
-           ((*core_2)[prev_n2]!=NULL_NODE
-            || class_2[prev_n2] != c) )
-      {
-      prev_n2++;
-      }
+    const nodeID_t *candidates = class_nodes->Nodes(c);
+    pred_set_size = class_nodes->Size(c);
+    while(last_candidate_index < pred_set_size
+          && (*core_2)[candidates[last_candidate_index]] != NULL_NODE)
+      last_candidate_index++;
+
+    if(last_candidate_index >= pred_set_size)
+      return false;
+    prev_n2 = candidates[last_candidate_index];
     }
   //std::cout<<curr_n1 << " " << prev_n2 << " \n";
 
@@ -417,6 +433,9 @@ EdgeComparisonFunctor >::IsFeasiblePair(nodeID_t node1, nodeID_t node2)
     || g1->OutEdgeCount(node1) > g2->OutEdgeCount(node2))
     return false;
 
+  if(signatures && !signatures->Compatible(node1, node2))
+    return false;
+
   int i, other1, other2, c_other;
   Edge1 eattr1;
   Edge2 eattr2;
@@ -428,7 +447,7 @@ EdgeComparisonFunctor >::IsFeasiblePair(nodeID_t node1, nodeID_t node2)
       if ((*core_1)[other1] != NULL_NODE)
         { other2=(*core_1)[other1];
           if (!g2->HasEdge(node2, other2, eattr2) ||
-              !ef(eattr1, eattr2))
+              !CompatibleEdges(ef, eattr1, eattr2))
             return false;
         }
     }
@@ -440,7 +459,7 @@ EdgeComparisonFunctor >::IsFeasiblePair(nodeID_t node1, nodeID_t node2)
       if ((*core_1)[other1]!=NULL_NODE)
         { other2=(*core_1)[other1];
           if (!g2->HasEdge(other2, node2, eattr2) ||
-              !ef(eattr1, eattr2))
+              !CompatibleEdges(ef, eattr1, eattr2))
             return false;
         }
     }
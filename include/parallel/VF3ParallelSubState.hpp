@@ -444,7 +444,7 @@ bool VF3ParallelSubState<Node1,Node2,Edge1,Edge2,NodeComparisonFunctor,EdgeCompa
       if (core_1[other1] != NULL_NODE)
         { other2=core_1[other1];
           if (!g2->HasEdge(node2, other2, eattr2) ||
-              !ef(eattr1, eattr2))
+              !CompatibleEdges(ef, eattr1, eattr2))
             return false;
         }
     }
@@ -456,7 +456,7 @@ bool VF3ParallelSubState<Node1,Node2,Edge1,Edge2,NodeComparisonFunctor,EdgeCompa
       if (core_1[other1]!=NULL_NODE)
         { other2=core_1[other1];
           if (!g2->HasEdge(other2, node2, eattr2) ||
-              !ef(eattr1, eattr2))
+              !CompatibleEdges(ef, eattr1, eattr2))
             return false;
         }
     }
@@ -76,12 +76,19 @@ int32_t main(int32_t argc, char** argv)
 	double timeFirst = 0;
 	double timeLast  = 0;
 	double timeLoad = 0;
+	double timeSetup = 0;	//Preprocessing done once, counted in each repetition
 	int rep = 0;
-	struct timeval start, loading, fastcheck, classification, iter, end;
+	struct timeval start, loading, fastcheck, classification, setup, iter, end;
 	std::vector<MatchingSolution> solutions;
 	std::vector<uint32_t> class_patt;
 	std::vector<uint32_t> class_targ;
 	uint32_t classes_count;
+#if defined(VF3) || defined(VF3L)
+	std::unique_ptr<CandidateDomains> domains;
+	std::unique_ptr<TargetWorkspace> workspace;
+#endif
+	std::unique_ptr<NeighborSignatures> signatures;
+	std::unique_ptr<TargetReduction<data_t, Empty> > reduction;
 
 	state_counter = 0;
 	size_t sols = 0;
@@ -122,16 +129,32 @@ int32_t main(int32_t argc, char** argv)
 
 	gettimeofday(&start, NULL);
 	// std::cout << "Solving edge-induced subgraph isomorphism problem? " << opt.edgeInduced << std::endl;
-	std::ifstream graphInPat(opt.pattern);
-	std::ifstream graphInTarg(opt.target);
-
 	// std::cout << "Loading pattern graph: " << opt.pattern << std::endl;
-	ARGLoader<data_t, Empty>* pattloader = CreateLoader<data_t, Empty>(opt, graphInPat);
+#ifdef VF3BIO
+	LabelDictionary<label_t> labels;
+	ARGraph<data_t, Empty>* patt_graph = CreateGraph<label_t, Empty>(opt, opt.pattern, labels);
+	ARGraph<data_t, Empty>* targ_graph = CreateGraph<label_t, Empty>(opt, opt.target, labels);
+#else
+	ARGraph<data_t, Empty>* patt_graph = CreateGraph<data_t, Empty>(opt, opt.pattern);
 	// std::cout << "Loading target graph: " << opt.target << std::endl;
-  	ARGLoader<data_t, Empty>* targloader = CreateLoader<data_t, Empty>(opt, graphInTarg);
+	ARGraph<data_t, Empty>* targ_graph = CreateGraph<data_t, Empty>(opt, opt.target);
+#endif
 
-	ARGraph<data_t, Empty> patt_graph(pattloader);
-	ARGraph<data_t, Empty> targ_graph(targloader);
+	if(!patt_graph || !targ_graph)
+	{
+		std::cout<<"Wrong Graph Format Selected\n";
+		exit(-1);
+	}
+
+#ifndef VF3B
+	//A reduced target gets its bitmap once built, before the pattern
+	if(opt.adjacencyBudget && !opt.reduceTarget)
+	{
+		size_t budget = (size_t)opt.adjacencyBudget << 20;
+		budget -= targ_graph->BuildAdjacencyBitmap(budget);
+		patt_graph->BuildAdjacencyBitmap(budget);
+	}
+#endif
 
 	if(opt.verbose)
 	{
@@ -140,8 +163,16 @@ int32_t main(int32_t argc, char** argv)
 		std::cout<<"Loaded in: "<<timeLoad<<std::endl;
 	}
 
-	n1 = patt_graph.NodeCount();
-	n2 = targ_graph.NodeCount();
+	n1 = patt_graph->NodeCount();
+	n2 = targ_graph->NodeCount();
+	ARGraph<data_t, Empty>* match_graph = targ_graph;	//Target of the search, possibly reduced
+
+	gettimeofday(&start, NULL);
+	std::shared_ptr<const TargetProfile<data_t, Empty> > profile = CreateTargetProfile(opt, targ_graph);
+	gettimeofday(&end, NULL);
+	timeSetup += GetElapsedTime(start, end);
+	if(opt.verbose)
+		std::cout<<"Target profile in: "<<timeSetup<<std::endl;
 
 	MatchingEngine<state_t >* me = CreateMatchingEngine(opt);
 
@@ -151,7 +182,7 @@ int32_t main(int32_t argc, char** argv)
 	}
 
 	gettimeofday(&start, NULL);
-	FastCheck<data_t, data_t, Empty, Empty > check(&patt_graph, &targ_graph);
+	FastCheck<data_t, data_t, Empty, Empty > check(patt_graph, targ_graph);
 	if(check.CheckSubgraphIsomorphism())
 	{
 		if(opt.verbose)
@@ -162,11 +193,11 @@ int32_t main(int32_t argc, char** argv)
 		}
 
 		gettimeofday(&start, NULL);
-		NodeClassifier<data_t, Empty> classifier(&targ_graph);
-		NodeClassifier<data_t, Empty> classifier2(&patt_graph, classifier);
+		HashNodeClassifier<data_t, Empty> classifier(targ_graph);
+		HashNodeClassifier<data_t, Empty> classifier2(patt_graph, classifier);
 		class_patt = classifier2.GetClasses();
 		class_targ = classifier.GetClasses();
-		classes_count = classifier.CountClasses();
+		classes_count = classifier2.CountClasses();
 
 		if(opt.verbose)
 		{
@@ -174,6 +205,77 @@ int32_t main(int32_t argc, char** argv)
 			timeLoad = GetElapsedTime(start, classification);
 			std::cout<<"Classification in: "<<timeLoad<<std::endl;
 		}
+
+		//Setup of the search for this pattern, counted in the match times
+		gettimeofday(&setup, NULL);
+		if(opt.reduceTarget)
+		{
+			gettimeofday(&start, NULL);
+			reduction.reset(new TargetReduction<data_t, Empty>(patt_graph, targ_graph, class_patt, class_targ, classes_count));
+			match_graph = reduction->GetGraph();
+			class_targ = reduction->GetClasses();
+#ifndef VF3B
+			if(opt.adjacencyBudget)
+			{
+				size_t budget = (size_t)opt.adjacencyBudget << 20;
+				budget -= match_graph->BuildAdjacencyBitmap(budget);
+				patt_graph->BuildAdjacencyBitmap(budget);
+			}
+#endif
+			if(opt.verbose)
+			{
+				gettimeofday(&classification, NULL);
+				timeLoad = GetElapsedTime(start, classification);
+				std::cout<<"Target reduced to "<<match_graph->NodeCount()<<" nodes in: "<<timeLoad<<std::endl;
+			}
+		}
+
+#ifdef VF3B
+		//The bitset state keeps an adjacency row of each target node
+		if(match_graph->NodeCount() > BIT_STATE_MAX_NODES)
+		{
+			std::cout<<"Target too large for vf3b: "<<match_graph->NodeCount()<<" nodes, at most "
+				<<BIT_STATE_MAX_NODES<<"; use vf3 or vf3l"<<std::endl;
+			exit(-1);
+		}
+		size_t row_bytes = state_t::RowBytes(match_graph);
+		if(row_bytes > ((size_t)opt.adjacencyBudget << 20))
+		{
+			std::cout<<"Target too large for vf3b: its bitset rows take "<<((row_bytes + (1 << 20) - 1) >> 20)
+				<<" MB, over the budget of "<<opt.adjacencyBudget<<" MB; raise -b or use vf3 or vf3l"<<std::endl;
+			exit(-1);
+		}
+#endif
+
+		//With a single class all the neighbors would be in the same run
+		if(opt.classIndex && classes_count > 1)
+			match_graph->BuildClassIndex(class_targ.data());
+
+#if defined(VF3) || defined(VF3L)
+		//The target arrays are set up once for all the repetitions
+		workspace.reset(new TargetWorkspace(match_graph->NodeCount(), class_targ.data()));
+
+		if(opt.candidateDomains)
+		{
+			gettimeofday(&start, NULL);
+			domains.reset(new CandidateDomains(patt_graph, match_graph, class_patt, class_targ, classes_count));
+			if(opt.verbose)
+			{
+				gettimeofday(&classification, NULL);
+				timeLoad = GetElapsedTime(start, classification);
+				std::cout<<"Candidate domains in: "<<timeLoad<<std::endl;
+			}
+		}
+		else
+#endif
+		{
+			//The domains already apply the exact neighbor classes filter
+			signatures.reset(new NeighborSignatures(patt_graph, match_graph, class_patt.data(), class_targ.data()));
+		}
+		gettimeofday(&end, NULL);
+		timeSetup += GetElapsedTime(setup, end);
+		if(opt.verbose)
+			std::cout<<"Search setup in: "<<GetElapsedTime(setup, end)<<std::endl;
 	}
 
 	#ifndef TRACE
@@ -187,8 +289,8 @@ int32_t main(int32_t argc, char** argv)
 		if(check.CheckSubgraphIsomorphism())
 		{
 			//
-			VF3NodeSorter<data_t, Empty, SubIsoNodeProbability<data_t, Empty>> sorter(&targ_graph);
-			std::vector<nodeID_t> sorted = sorter.SortNodes(&patt_graph);
+			VF3NodeSorter<data_t, Empty, SubIsoNodeProbability<data_t, Empty>> sorter(profile);
+			std::vector<nodeID_t> sorted = sorter.SortNodes(patt_graph);
 
 			// std::cout << "Sorted nodes: ";
 			// for (auto i : sorted)
@@ -200,7 +302,20 @@ int32_t main(int32_t argc, char** argv)
 			me->InitTrace(outfilename);
 			#endif
 			
-			state_t s0(&patt_graph, &targ_graph, class_patt.data(), class_targ.data(), classes_count, sorted.data(), opt.edgeInduced); 
+#if defined(VF3) || defined(VF3L)
+			state_t s0(patt_graph, match_graph, class_patt.data(), class_targ.data(), classes_count, sorted.data(), opt.edgeInduced,
+				workspace.get());
+			s0.SetCandidateDomains(domains.get());
+#else
+			state_t s0(patt_graph, match_graph, class_patt.data(), class_targ.data(), classes_count, sorted.data(), opt.edgeInduced);
+#endif
+			s0.SetNeighborSignatures(signatures.get());
+#if defined(VF3) || defined(VF3L)
+			std::unique_ptr<NeighborIntersection> intersection;
+			if(opt.intersectCandidates)
+				intersection.reset(new NeighborIntersection(patt_graph, sorted.data()));
+			s0.SetNeighborIntersection(intersection.get());
+#endif
             
             if(opt.firstOnly)
             {
@@ -228,11 +343,13 @@ int32_t main(int32_t argc, char** argv)
             }
 		
 	} while (totalExecTime < opt.repetitionTimeLimit);
-	timeAll = totalExecTime/rep;
+	//The search used to compute the target statistics at every repetition,
+	//and the setup is part of the search for a single pattern
+	timeAll = totalExecTime/rep + timeSetup;
 	
     if(!opt.firstOnly)
     {
-        timeFirst /= rep;
+        timeFirst = timeFirst/rep + timeSetup;
     }
     else
     {
@@ -243,6 +360,11 @@ int32_t main(int32_t argc, char** argv)
 	if(opt.storeSolutions)
 	{
 		me->GetSolutions(solutions);
+		if(reduction)
+		{
+			for(size_t i = 0; i < solutions.size(); i++)
+				reduction->RestoreSolution(solutions[i]);
+		}
 		std::cout << "Solution Found" << std::endl;
 		std::vector<MatchingSolution>::iterator it;
 		for(it = solutions.begin(); it != solutions.end(); it++)
@@ -263,7 +385,7 @@ int32_t main(int32_t argc, char** argv)
 		std::cout << sols << " " << timeFirst << " " << timeAll << std::endl;
 	}
 	delete me;
-  	delete pattloader;
-  	delete targloader;
+	delete patt_graph;
+	delete targ_graph;
 	return 0;
 }
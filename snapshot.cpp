@@ -0,0 +1,67 @@
+/**
+ * @file   snapshot.cpp
+ * @brief  Converts a graph file into a binary snapshot that can be
+ * memory mapped by vf3 using the format snap.
+ * The profile of the graph, used when it is the target, is saved
+ * next to the snapshot with the extension .prof.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include "VFLib.h"
+#include "Options.hpp"
+
+using namespace vflib;
+
+void PrintSnapshotUsage()
+{
+	std::cout<<"vf3snap [input graph] [output snapshot] -u -f [graph format]"<<std::endl;
+}
+
+int32_t main(int32_t argc, char** argv)
+{
+	Options opt;
+	char option;
+
+	while ((option = getopt (argc, argv, ":f:u")) != -1)
+	{
+		switch (option)
+		{
+			case 'f':
+				opt.format = std::string(optarg);
+				break;
+			case 'u':
+				opt.undirected = true;
+				break;
+			case '?':
+				PrintSnapshotUsage();
+				return -1;
+		}
+	}
+
+	if(argc - optind < 2 || opt.format == "snap")
+	{
+		PrintSnapshotUsage();
+		return -1;
+	}
+
+	ARGraph<data_t, Empty>* graph = CreateGraph<data_t, Empty>(opt, argv[optind]);
+	if(!graph)
+	{
+		std::cout<<"Wrong Graph Format Selected\n";
+		return -1;
+	}
+
+	WriteARGraphSnapshot(*graph, argv[optind+1]);
+	//The edges are checked once here, the searches only check the layout
+	MapARGraphSnapshot<data_t, Empty>(argv[optind+1], true);
+	TargetProfile<data_t, Empty>(graph).Save(std::string(argv[optind+1]) + ".prof");
+	delete graph;
+	return 0;
+}